@@ -1,7 +1,11 @@
 #include "analysis.hpp"
 #include "macros.hpp"
 #include "input_config.hpp"
-#include "libs/kissfft/kiss_fftr.h"
+#include "wavetables.hpp"
+#include "control_queue.hpp"
+#include "const_math.hpp"
+#include "libs/kissfft/kiss_fft.h"
+#include "pico/stdlib.h" // time_us_32
 #include <stdio.h> 
 #include <string.h> // for memset, memmove
 
@@ -16,16 +20,125 @@ constexpr int   STABILITY_COUNT = 2;      // Frames required to lock a note
 constexpr float ADC_BIAS = 2048.0f;       // 12-bit ADC Center
 constexpr float MIN_FREQ_SEP = 4.9f;      // Min Hz separation for guitar notes
 
+// Phase Measurement
+// The Hann window is centered on sample (N-1)/2, which was captured this long
+// before the last sample of the frame
+constexpr uint32_t FRAME_CENTER_AGE_US = (uint32_t)((I_BUFFER_SIZE - 1) * 1000000ULL / (2 * FS_I));
+
+// Timbre Capture
+constexpr float CAPTURE_SMOOTHING = 0.2f;       // Per-frame weight of a new profile
+constexpr float CAPTURE_CHANGE_THRESHOLD = 0.1f; // Summed profile change that triggers a rebuild
+constexpr int   CAPTURE_MIN_FRAMES = 10;        // Frames between rebuilds (~1 s)
+
 // --- Internal State ---
+// Per-bin analysis state. 'out' is what the synthesis gets (copied into a
+// ControlFrame each hop); the rest is history only the analysis needs.
+typedef struct BinState {
+    VoiceControl out;
+    float amp_float;            // History for jitter filter
+    bool is_peak;               // Debug/Vis flag
+    int stability;              // Debounce counter
+} BinState;
+
+static BinState bins[NUM_FREQS];
 static int MODES_RESOLUTION;
 static float processing_buffer[I_BUFFER_SIZE];
-static float hanning_window[I_BUFFER_SIZE];
 
-// KissFFT State
-static kiss_fftr_cfg fft_cfg;           
+// FFT State
+// The real FFT is done in slices: the 512 real samples, packed as 256
+// complex ones, are split into FFT_SUB_COUNT interleaved 64-point FFTs
+// (kissfft), then combined with one radix-4 pass and split into the real
+// spectrum (the same post-processing kiss_fftr does).
+constexpr int FFT_CPX = FFT_SIZE / 2;                 // Packed complex length
+constexpr int FFT_SUB_COUNT = 4;                      // Radix of the combine pass
+constexpr int FFT_SUB_SIZE = FFT_CPX / FFT_SUB_COUNT;
+static kiss_fft_cfg fft_sub_cfg;
 static float fft_in_r[I_BUFFER_SIZE];     
 static kiss_fft_cpx fft_out_cpx[FFT_SIZE / 2 + 1]; 
 
+// Window and twiddles: computed by the compiler (const_math.hpp), copied to
+// SRAM at boot with the rest of .data
+static constexpr std::array<float, I_BUFFER_SIZE> make_hann() {
+    std::array<float, I_BUFFER_SIZE> t{};
+    for (int i = 0; i < I_BUFFER_SIZE; i++) {
+        t[i] = (float)(0.5 - 0.5 * ce_cos(TWO_PI * i / (I_BUFFER_SIZE - 1)));
+    }
+    return t;
+}
+
+// exp(-2 pi i q k / FFT_CPX), q = 1..FFT_SUB_COUNT-1
+static constexpr std::array<std::array<kiss_fft_cpx, FFT_SUB_SIZE>, FFT_SUB_COUNT - 1> make_combine_twiddles() {
+    std::array<std::array<kiss_fft_cpx, FFT_SUB_SIZE>, FFT_SUB_COUNT - 1> t{};
+    for (int q = 1; q < FFT_SUB_COUNT; q++) {
+        for (int k = 0; k < FFT_SUB_SIZE; k++) {
+            double phase = -TWO_PI * (q * k) / FFT_CPX;
+            t[q - 1][k].r = (float)ce_cos(phase);
+            t[q - 1][k].i = (float)ce_sin(phase);
+        }
+    }
+    return t;
+}
+
+// exp(-pi i ((k + 1) / FFT_CPX + 0.5))
+static constexpr std::array<kiss_fft_cpx, FFT_CPX / 2> make_split_twiddles() {
+    std::array<kiss_fft_cpx, FFT_CPX / 2> t{};
+    for (int k = 0; k < FFT_CPX / 2; k++) {
+        double phase = -CE_PI * ((double)(k + 1) / FFT_CPX + 0.5);
+        t[k].r = (float)ce_cos(phase);
+        t[k].i = (float)ce_sin(phase);
+    }
+    return t;
+}
+
+// Sub-FFT plan twiddles, exp(-2 pi i k / FFT_SUB_SIZE). Only copied into the
+// plan at init, so they stay in flash.
+static constexpr std::array<kiss_fft_cpx, FFT_SUB_SIZE> make_sub_twiddles() {
+    std::array<kiss_fft_cpx, FFT_SUB_SIZE> t{};
+    for (int k = 0; k < FFT_SUB_SIZE; k++) {
+        double phase = -TWO_PI * k / FFT_SUB_SIZE;
+        t[k].r = (float)ce_cos(phase);
+        t[k].i = (float)ce_sin(phase);
+    }
+    return t;
+}
+
+static constexpr std::array<float, I_BUFFER_SIZE> RAM_TABLE("hann") hanning_window = make_hann();
+static constexpr std::array<std::array<kiss_fft_cpx, FFT_SUB_SIZE>, FFT_SUB_COUNT - 1> RAM_TABLE("fft_twiddles") combine_twiddles = make_combine_twiddles();
+static constexpr std::array<kiss_fft_cpx, FFT_CPX / 2> RAM_TABLE("fft_twiddles") split_twiddles = make_split_twiddles();
+static constexpr std::array<kiss_fft_cpx, FFT_SUB_SIZE> sub_twiddles = make_sub_twiddles();
+
+// Slicing
+// Each slice is a bounded piece of work; the caller checks its worst
+// measured cost against the time left before the next output refill.
+typedef enum {
+    SLICE_IDLE = 0,
+    SLICE_WINDOW,               // Window into the FFT input
+    SLICE_FFT_SUB,              // One 64-point sub-FFT (x FFT_SUB_COUNT)
+    SLICE_FFT_COMBINE,          // Radix-4 pass over the sub-FFTs
+    SLICE_FFT_SPLIT,            // Packed complex -> real spectrum
+    SLICE_MAGNITUDES,           // One range of magnitudes (x SLICE_RANGES)
+    SLICE_PEAKS,                // One range of the peak & state pass (x SLICE_RANGES)
+    SLICE_PUBLISH,              // Timbre capture, ControlFrame
+    SLICE_KINDS
+} Analysis_Slice;
+
+constexpr int SLICE_RANGES = 4;
+constexpr int SLICE_RANGE_BINS = NUM_FREQS / SLICE_RANGES;
+static_assert(NUM_FREQS % SLICE_RANGES == 0, "Slice ranges must cover every bin");
+
+static Analysis_Slice next_slice = SLICE_IDLE;
+static int slice_part = 0;                    // Sub-FFT or bin range within the slice kind
+static uint32_t slice_max_us[SLICE_KINDS];    // Worst measured cost per slice kind
+static uint32_t frame_center_us = 0;          // Window center time of the frame in progress
+static float current_amps[NUM_FREQS];
+static int active_peak_count = 0;
+
+// Timbre Capture State
+static bool timbre_capture = false;
+static float captured_profile[MAX_TIMBRE_HARMONICS];  // Smoothed, relative to the fundamental
+static float published_profile[MAX_TIMBRE_HARMONICS]; // Last profile sent to the wavetable builder
+static int frames_since_publish = 0;
+
 // --- Helper Functions ---
 
 static bool is_peak(float* amps, int k, int num_freqs) {
@@ -48,21 +161,128 @@ static int get_env_phase(float amp_now, float amp_prev) {
     return 0; // Sustain
 }
 
-// --- Public Functions ---
+// Fractional bin offset of a peak (parabolic fit on the magnitudes), -0.5..0.5
+static inline float peak_offset(float* amps, int k) {
+    float a = amps[k - 1], b = amps[k], c = amps[k + 1];
+    float denom = a - 2.0f * b + c;
+    return (denom != 0.0f) ? 0.5f * (a - c) / denom : 0.0f;
+}
 
-void analysis_init() {
-    // 1. Pre-calc Window
-    for (int i = 0; i < I_BUFFER_SIZE; i++) {
-        hanning_window[i] = 0.5f - 0.5f * cosf(2.0f * M_PI * i / (I_BUFFER_SIZE - 1));
+// Frequency and phase of a peak at the window center.
+// Shifting the sum to the window center makes the window's spectrum real and
+// positive over its main lobe, so: phase_center = arg X[k] + pi k (N-1)/N.
+// With a measurement from the previous frame, the frequency is refined from the
+// phase advance between frames (phase vocoder), which is far more precise than
+// the parabolic fit and matters when the phase is extrapolated ~200 ms ahead.
+static void measure_phase(VoiceControl* bin, float* amps, int k, uint32_t center_us) {
+    float freq_hz = ((float)k + peak_offset(amps, k)) * (float)FS_I / (float)FFT_SIZE;
+
+    float phase = atan2f(fft_out_cpx[k].i, fft_out_cpx[k].r)
+                + (float)M_PI * (float)k * (float)(I_BUFFER_SIZE - 1) / (float)I_BUFFER_SIZE
+                + (float)M_PI / 2.0f; // cos -> sin, to match the oscillator's phase convention
+
+    float cycles = phase / (float)TWO_PI;
+    cycles -= floorf(cycles);
+    uint32_t new_phase = (uint32_t)(int64_t)(cycles * (float)two32);
+
+    if (bin->phase_valid) {
+        // Deviation from the advance the coarse estimate predicts, wrapped to +/-0.5 cycle
+        float dt = (float)(center_us - bin->string_phase_us) * 1e-6f;
+        if (dt > 0.0f) {
+            float predicted = freq_hz * dt;
+            float advance = (float)(new_phase - bin->string_phase) / (float)two32;
+            float deviation = advance - (predicted - floorf(predicted));
+            deviation -= floorf(deviation + 0.5f);
+            freq_hz += deviation / dt;
+        }
     }
 
-    // 2. Clear Buffers
+    bin->string_freq_hz = freq_hz;
+    bin->string_phase = new_phase;
+    bin->string_phase_us = center_us;
+    bin->phase_valid = true;
+}
+
+// Measures the harmonic profile of the lowest playing note, mutes its
+// harmonic voices, and rebuilds the synth table when the profile moves.
+static void capture_timbre(float* amps) {
+    frames_since_publish++;
+
+    // 1. Fundamental: the lowest bin currently playing
+    int k0 = -1;
+    for (int k = 1; k < NUM_FREQS - 1; k++) {
+        if (bins[k].out.play) { k0 = k; break; }
+    }
+    if (k0 < 0) return; // Nothing playing: keep the last timbre
+
+    // Parabolic interpolation for a fractional bin, so high harmonics land on the right bin
+    float k0_frac = (float)k0 + peak_offset(amps, k0);
+
+    // 2. Measure each harmonic (strongest bin within +/-1 of h * f0)
+    float measured[MAX_TIMBRE_HARMONICS] = {0};
+    float note_amp = 0.0f;
+    int num_harmonics = 0;
+    for (int h = 1; h <= MAX_TIMBRE_HARMONICS; h++) {
+        int center = (int)(h * k0_frac + 0.5f);
+        if (center + 1 >= NUM_FREQS) break; // Above the analysis band
+
+        float peak = 0.0f;
+        for (int k = center - 1; k <= center + 1; k++) {
+            if (amps[k] > peak) peak = amps[k];
+        }
+        if (peak < PEAK_THRESHOLD) peak = 0.0f;
+        measured[h - 1] = peak;
+        note_amp += peak;
+        num_harmonics = h;
+
+        // 3. Mute the harmonic's own voices: the table now plays it
+        if (h > 1) {
+            for (int k = center - MODES_RESOLUTION; k <= center + MODES_RESOLUTION; k++) {
+                if (k <= k0 || k >= NUM_FREQS) continue;
+                bins[k].out.play = false;
+                bins[k].out.amp = 0;
+            }
+        }
+    }
+    if (measured[0] <= 0.0f) return;
+
+    // 4. Fundamental voice carries the whole note (the table is normalized to its harmonic sum)
+    float boosted = note_amp * AMP_CORRECTION_FACTOR;
+    if (boosted > 1.0f) boosted = 1.0f;
+    bins[k0].out.amp = (int16_t)(boosted * 32767.0f);
+
+    // 5. Smooth the profile and rebuild the table when it has moved enough
+    float change = 0.0f;
+    for (int h = 0; h < MAX_TIMBRE_HARMONICS; h++) {
+        float rel = measured[h] / measured[0];
+        captured_profile[h] += CAPTURE_SMOOTHING * (rel - captured_profile[h]);
+        change += fabsf(captured_profile[h] - published_profile[h]);
+    }
+
+    if (frames_since_publish >= CAPTURE_MIN_FRAMES && change > CAPTURE_CHANGE_THRESHOLD) {
+        memcpy(published_profile, captured_profile, sizeof(published_profile));
+        set_synth_table_harmonics(published_profile, num_harmonics);
+        frames_since_publish = 0;
+
+        #ifdef DEBUG_ANALYSIS
+        printf("[Analysis] Timbre captured: f0 bin %.2f, %d harmonics\n", k0_frac, num_harmonics);
+        #endif
+    }
+}
+
+// --- Public Functions ---
+
+void analysis_init() {
+    // 1. Clear Buffers
     memset(processing_buffer, 0, sizeof(processing_buffer));
+    memset(bins, 0, sizeof(bins));
 
-    // 3. Alloc FFT
-    fft_cfg = kiss_fftr_alloc(I_BUFFER_SIZE, 0, NULL, NULL);
+    // 2. Alloc FFT (window and twiddles are precomputed)
+    fft_sub_cfg = kiss_fft_alloc_twiddles(FFT_SUB_SIZE, 0, sub_twiddles.data(), NULL, NULL);
+    next_slice = SLICE_IDLE;
+    memset(slice_max_us, 0, sizeof(slice_max_us));
 
-    // 4. Calc Resolution
+    // 3. Calc Resolution
     float bin_width_hz = (float)FS_I / (float)I_BUFFER_SIZE;
     MODES_RESOLUTION = (int)(MIN_FREQ_SEP / bin_width_hz);
     if (MODES_RESOLUTION < 1) MODES_RESOLUTION = 1;
@@ -70,41 +290,72 @@ void analysis_init() {
     printf("[Analysis] Init. Res: %.2f Hz/bin, Search Radius: %d bins\n", bin_width_hz, MODES_RESOLUTION);
 }
 
-void analyze_audio_segment(int16_t* new_samples) {
-    
-    // 1. Sliding Window (Overlap)
-    // Shift old data left
-    size_t samples_to_keep = I_BUFFER_SIZE - HOP_SIZE;
-    memmove(processing_buffer, &processing_buffer[HOP_SIZE], samples_to_keep * sizeof(float));
+// --- FFT Slices ---
 
-    // 2. Normalize New Data (Int16 -> Float -1.0 to 1.0)
-    for (int i = 0; i < HOP_SIZE; i++) {
-        processing_buffer[samples_to_keep + i] = ((float)new_samples[i] - ADC_BIAS) / ADC_BIAS;
+// One radix-4 butterfly per k: the four sub-FFT outputs k, k + 64, k + 128,
+// k + 192 become the outputs at the same positions, so it runs in place
+static void fft_combine() {
+    kiss_fft_cpx *z = fft_out_cpx;
+    for (int k = 0; k < FFT_SUB_SIZE; k++) {
+        kiss_fft_cpx a0 = z[k];
+        kiss_fft_cpx a[FFT_SUB_COUNT - 1];
+        for (int q = 1; q < FFT_SUB_COUNT; q++) {
+            kiss_fft_cpx x = z[q * FFT_SUB_SIZE + k];
+            kiss_fft_cpx w = combine_twiddles[q - 1][k];
+            a[q - 1].r = x.r * w.r - x.i * w.i;
+            a[q - 1].i = x.r * w.i + x.i * w.r;
+        }
+        // W4 = -i
+        float s02r = a0.r + a[1].r, s02i = a0.i + a[1].i;
+        float d02r = a0.r - a[1].r, d02i = a0.i - a[1].i;
+        float s13r = a[0].r + a[2].r, s13i = a[0].i + a[2].i;
+        float d13r = a[0].r - a[2].r, d13i = a[0].i - a[2].i;
+        z[k].r                     = s02r + s13r;  z[k].i                     = s02i + s13i;
+        z[k + FFT_SUB_SIZE].r      = d02r + d13i;  z[k + FFT_SUB_SIZE].i      = d02i - d13r;
+        z[k + 2 * FFT_SUB_SIZE].r  = s02r - s13r;  z[k + 2 * FFT_SUB_SIZE].i  = s02i - s13i;
+        z[k + 3 * FFT_SUB_SIZE].r  = d02r - d13i;  z[k + 3 * FFT_SUB_SIZE].i  = d02i + d13r;
     }
+}
 
-    // 3. Apply Window & Prepare FFT
-    for (int i = 0; i < I_BUFFER_SIZE; i++) {
-        fft_in_r[i] = processing_buffer[i] * hanning_window[i];
+// Packed complex spectrum Z of the even/odd samples -> real spectrum X
+// (as kiss_fftr). Pairs k and FFT_CPX - k are read before either is written.
+static void fft_split() {
+    kiss_fft_cpx *x = fft_out_cpx;
+    kiss_fft_cpx dc = x[0];
+    x[0].r = dc.r + dc.i;
+    x[FFT_CPX].r = dc.r - dc.i;
+    x[0].i = x[FFT_CPX].i = 0.0f;
+
+    for (int k = 1; k <= FFT_CPX / 2; k++) {
+        kiss_fft_cpx fpk = x[k];
+        kiss_fft_cpx fpnk = { x[FFT_CPX - k].r, -x[FFT_CPX - k].i };
+        float f1r = fpk.r + fpnk.r, f1i = fpk.i + fpnk.i;
+        float f2r = fpk.r - fpnk.r, f2i = fpk.i - fpnk.i;
+        kiss_fft_cpx w = split_twiddles[k - 1];
+        float twr = f2r * w.r - f2i * w.i;
+        float twi = f2r * w.i + f2i * w.r;
+        x[k].r = 0.5f * (f1r + twr);
+        x[k].i = 0.5f * (f1i + twi);
+        x[FFT_CPX - k].r = 0.5f * (f1r - twr);
+        x[FFT_CPX - k].i = 0.5f * (twi - f1i);
     }
+}
 
-    // 4. Execute FFT
-    kiss_fftr(fft_cfg, fft_in_r, fft_out_cpx);
+// --- Analysis Slices ---
 
-    // 5. Calculate Magnitudes (First Pass)
-    // We need all amplitudes calculated before checking neighbors for peaks
-    float current_amps[NUM_FREQS]; 
-    for (int k = 0; k < NUM_FREQS; k++) {
-        // Normalization: Divide by N/2
-        float norm = (I_BUFFER_SIZE / 2.0f);
-        float mag = sqrtf(fft_out_cpx[k].r * fft_out_cpx[k].r + fft_out_cpx[k].i * fft_out_cpx[k].i) / norm;
-        current_amps[k] = mag;
+// Magnitudes of one bin range. Every range is done before the peak pass,
+// which looks at neighbouring bins.
+static void compute_magnitudes(int k_begin, int k_end) {
+    const float norm = (I_BUFFER_SIZE / 2.0f); // Normalization: Divide by N/2
+    for (int k = k_begin; k < k_end; k++) {
+        current_amps[k] = sqrtf(fft_out_cpx[k].r * fft_out_cpx[k].r + fft_out_cpx[k].i * fft_out_cpx[k].i) / norm;
     }
+}
 
-    // 6. Analysis & State Update (Second Pass)
-    int active_peak_count = 0;
-
-    for (int k = 0; k < NUM_FREQS; k++) {
-        FreqData* bin = &frq_array[k]; // Pointer to global state
+// Peak detection & state update for one bin range
+static void update_bins(int k_begin, int k_end) {
+    for (int k = k_begin; k < k_end; k++) {
+        BinState* bin = &bins[k];
         float new_amp = current_amps[k];
         float prev_amp = bin->amp_float;
 
@@ -112,11 +363,11 @@ void analyze_audio_segment(int16_t* new_samples) {
         bin->is_peak = is_peak(current_amps, k, NUM_FREQS);
 
         if (bin->is_peak) {
-            bin->env_phase = get_env_phase(new_amp, prev_amp);
+            bin->out.env_phase = (int8_t)get_env_phase(new_amp, prev_amp);
             bin->stability++;
 
             if (bin->stability > STABILITY_COUNT) {
-                bin->play = true;
+                bin->out.play = true;
                 active_peak_count++;
 
                 // --- Jitter Filter (Low Pass) ---
@@ -128,22 +379,169 @@ void analyze_audio_segment(int16_t* new_samples) {
                 float boosted = smoothed_target * AMP_CORRECTION_FACTOR;
                 if (boosted > 1.0f) boosted = 1.0f;
                 
-                bin->amp = (int16_t)(boosted * 32767.0f);
+                bin->out.amp = (int16_t)(boosted * 32767.0f);
+
+                // Phase at a known time, for phase-coherent resynthesis
+                measure_phase(&bin->out, current_amps, k, frame_center_us);
             }
         } else {
             // Decay Logic
-            bin->env_phase = 0;
+            bin->out.env_phase = 0;
             bin->stability = 0;
-            bin->play = false;
-            bin->amp = 0;
+            bin->out.play = false;
+            bin->out.amp = 0;
+            bin->out.phase_valid = false;
             // Immediate update for history
              bin->amp_float = new_amp;
         }
     }
+}
+
+static void publish_frame() {
+    // Timbre Capture (One Voice Per Note)
+    if (timbre_capture) {
+        capture_timbre(current_amps);
+    }
+
+    // Hand the results to the synthesis
+    // If it hasn't taken the previous frames yet, this hop is dropped; the
+    // next one carries the full state again.
+    ControlFrame *frame = control_frame_acquire();
+    if (frame) {
+        for (int k = 0; k < NUM_FREQS; k++) {
+            frame->voice[k] = bins[k].out;
+        }
+        control_frame_publish(frame);
+    }
 
     #ifdef DEBUG_ANALYSIS
     if (active_peak_count > 0) {
         printf(">> Peaks: %d\n", active_peak_count);
     }
     #endif
+}
+
+void analysis_start(const int16_t* new_samples, uint32_t capture_us) {
+    // Time of the window center, for the phase measurements
+    frame_center_us = capture_us - FRAME_CENTER_AGE_US;
+
+    // 1. Sliding Window (Overlap)
+    // Shift old data left
+    size_t samples_to_keep = I_BUFFER_SIZE - HOP_SIZE;
+    memmove(processing_buffer, &processing_buffer[HOP_SIZE], samples_to_keep * sizeof(float));
+
+    // 2. Normalize New Data (Int16 -> Float -1.0 to 1.0)
+    // The hop is copied here, so the input block can be released right away
+    for (int i = 0; i < HOP_SIZE; i++) {
+        processing_buffer[samples_to_keep + i] = ((float)new_samples[i] - ADC_BIAS) / ADC_BIAS;
+    }
+
+    next_slice = SLICE_WINDOW;
+    slice_part = 0;
+}
+
+bool analysis_busy() {
+    return next_slice != SLICE_IDLE;
+}
+
+uint32_t analysis_next_slice_us() {
+    return slice_max_us[next_slice];
+}
+
+uint32_t analysis_max_slice_us() {
+    uint32_t worst = 0;
+    for (int s = 0; s < SLICE_KINDS; s++) {
+        if (slice_max_us[s] > worst) worst = slice_max_us[s];
+    }
+    return worst;
+}
+
+bool analysis_run_slice() {
+    if (next_slice == SLICE_IDLE) return false;
+
+    uint32_t start = time_us_32();
+    Analysis_Slice slice = next_slice;
+
+    switch (slice) {
+        case SLICE_WINDOW:
+            // 3. Apply Window & Prepare FFT
+            for (int i = 0; i < I_BUFFER_SIZE; i++) {
+                fft_in_r[i] = processing_buffer[i] * hanning_window[i];
+            }
+            next_slice = SLICE_FFT_SUB;
+            break;
+
+        case SLICE_FFT_SUB: {
+            // 4. Execute FFT: samples q, q + 4, ... of the packed input
+            const kiss_fft_cpx *packed = (const kiss_fft_cpx *)fft_in_r;
+            kiss_fft_stride(fft_sub_cfg, packed + slice_part,
+                            &fft_out_cpx[slice_part * FFT_SUB_SIZE], FFT_SUB_COUNT);
+            if (++slice_part == FFT_SUB_COUNT) {
+                slice_part = 0;
+                next_slice = SLICE_FFT_COMBINE;
+            }
+            break;
+        }
+
+        case SLICE_FFT_COMBINE:
+            fft_combine();
+            next_slice = SLICE_FFT_SPLIT;
+            break;
+
+        case SLICE_FFT_SPLIT:
+            fft_split();
+            next_slice = SLICE_MAGNITUDES;
+            break;
+
+        case SLICE_MAGNITUDES:
+            // 5. Calculate Magnitudes (First Pass)
+            compute_magnitudes(slice_part * SLICE_RANGE_BINS, (slice_part + 1) * SLICE_RANGE_BINS);
+            if (++slice_part == SLICE_RANGES) {
+                slice_part = 0;
+                active_peak_count = 0;
+                next_slice = SLICE_PEAKS;
+            }
+            break;
+
+        case SLICE_PEAKS:
+            // 6. Analysis & State Update (Second Pass)
+            update_bins(slice_part * SLICE_RANGE_BINS, (slice_part + 1) * SLICE_RANGE_BINS);
+            if (++slice_part == SLICE_RANGES) {
+                slice_part = 0;
+                next_slice = SLICE_PUBLISH;
+            }
+            break;
+
+        case SLICE_PUBLISH:
+            // 7. Timbre Capture & 8. Hand the results to the synthesis
+            publish_frame();
+            next_slice = SLICE_IDLE;
+            break;
+
+        default:
+            next_slice = SLICE_IDLE;
+            break;
+    }
+
+    uint32_t elapsed = time_us_32() - start;
+    if (elapsed > slice_max_us[slice]) slice_max_us[slice] = elapsed;
+    return next_slice == SLICE_IDLE;
+}
+
+void analyze_audio_segment(const int16_t* new_samples, uint32_t capture_us) {
+    analysis_start(new_samples, capture_us);
+    while (!analysis_run_slice()) {
+    }
+}
+
+void set_timbre_capture(bool enable) {
+    if (enable && !timbre_capture) {
+        // Start from a pure fundamental and force a first rebuild
+        memset(captured_profile, 0, sizeof(captured_profile));
+        memset(published_profile, 0, sizeof(published_profile));
+        captured_profile[0] = 1.0f;
+        frames_since_publish = CAPTURE_MIN_FRAMES;
+    }
+    timbre_capture = enable;
+    printf("[Analysis] Timbre capture %s\n", enable ? "ON" : "OFF");
 }
\ No newline at end of file
@@ -21,15 +21,62 @@
 void analysis_init();
 
 /**
- * @brief Processes a new buffer of audio samples.
+ * @brief Starts the analysis of a new hop (time-sliced).
+ * Copies the hop into the sliding window, so the input block can be
+ * released as soon as this returns. The rest of the pipeline below runs
+ * one bounded slice per analysis_run_slice() call.
+ * @param new_samples Pointer to the DMA buffer (size: HOP_SIZE)
+ * @param capture_us  Capture time of the block's last sample (InputBlock::capture_us)
+ */
+void analysis_start(const int16_t* new_samples, uint32_t capture_us);
+
+/**
+ * @brief Runs the next slice of the frame in progress: window, each of the
+ * four sub-FFTs, FFT combine, real split, four magnitude ranges, four peak
+ * ranges, then the publish step.
+ * @return true once the frame is complete and published
+ */
+bool analysis_run_slice();
+
+/**
+ * @brief true while a frame started by analysis_start() is unfinished.
+ */
+bool analysis_busy();
+
+/**
+ * @brief Worst measured cost of the next slice (0 until it has run once),
+ * for checking it against the output deadline before running it.
+ */
+uint32_t analysis_next_slice_us();
+
+/**
+ * @brief Worst measured cost of any slice since boot.
+ */
+uint32_t analysis_max_slice_us();
+
+/**
+ * @brief Processes a new buffer of audio samples in one call (all slices).
  * Pipeline:
  * 1. Overlap-Add (Sliding Window)
  * 2. Windowing (Hanning)
  * 3. FFT (Real-to-Complex)
  * 4. Peak Detection & Stability Check
- * 5. Parameter Mapping (Updates global frq_array)
+ * 5. Parameter Mapping (Publishes a ControlFrame, see control_queue.hpp)
  * * @param new_samples Pointer to the DMA buffer (size: HOP_SIZE)
+ * @param capture_us  Capture time of the block's last sample (InputBlock::capture_us)
+ */
+void analyze_audio_segment(const int16_t* new_samples, uint32_t capture_us);
+
+/**
+ * @brief Timbre capture mode.
+ * Each frame, the harmonic profile of the lowest playing note is measured
+ * (amplitude of each harmonic relative to the fundamental), smoothed, and
+ * turned into the synth wavetable. The note is then played by its
+ * fundamental voice alone: its harmonic bins are muted, so one voice per
+ * note replaces one voice per harmonic.
+ * Disabling leaves the captured table in place until set_synth_table().
+ * @param enable true to start capturing
  */
-void analyze_audio_segment(int16_t* new_samples);
+void set_timbre_capture(bool enable);
 
 #endif // ANALYSIS_H
\ No newline at end of file
@@ -0,0 +1,246 @@
+/**
+ * File: benchmarks.cpp
+ * Description: On-target micro-benchmarks for the synthesis kernels.
+ * Each kernel renders a single steady voice; cost is reported in CPU cycles
+ * per output sample, quality as spurious-free dynamic range (SFDR).
+ */
+
+#include "benchmarks.hpp"
+#include "macros.hpp"
+#include "oscillators.hpp"
+#include "wavetables.hpp"
+#include "output_stage.hpp"
+#include "output_config.hpp" // get_output_stats (audio running check)
+#include "libs/kissfft/kiss_fftr.h"
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --- Constants ---
+constexpr int   BENCH_BLOCKS    = 200;     // Blocks timed per kernel
+constexpr float BENCH_FREQ_HZ   = 440.0f;  // Test tone (not bin-centered)
+constexpr int   SFDR_FFT_LEN    = 2048;
+constexpr int   SFDR_GUARD_BINS = 8;       // Window main lobe + skirts around the tone
+constexpr int   LOOKUP_PASSES   = 64;      // Full-table sweeps timed per lookup method
+constexpr int   CHORD_NOTES     = 6;       // Output stage test signal: 6 full voices
+
+static const char *const OSC_SOURCE_NAMES[OSC_SOURCE_COUNT] = {
+    "Table", "Table interp", "Xfade", "Xfade interp", "Recursive"
+};
+
+// --- Helper Functions ---
+
+// Kernel inputs for a full-scale voice. The crossfade reads the same table twice,
+// so its output (and SFDR) is comparable with the plain table. The ramp is a
+// slow fade, just enough to take the envelope path.
+static OscBlock make_block(bool ramp) {
+    OscBlock b;
+    b.table = current_wave_table;
+    b.prev_table = current_wave_table;
+    b.amp_q16 = 32767 << 16;
+    b.amp_step = ramp ? -1 : 0;
+    b.xfade_q24 = 0;
+    b.xfade_step = 1;
+    return b;
+}
+
+// Steady full-scale voice (flat envelope)
+static FreqData make_voice(float freq_hz) {
+    FreqData v;
+    memset(&v, 0, sizeof(v));
+    v.play = true;
+    v.increment_j = (uint32_t)(freq_hz * (two32 / (double)FS_O));
+    v.amp = 32767;
+    v.current_amp = 32767;
+    return v;
+}
+
+static float cycles_per_sample(osc_kernel_fn fn, const OscBlock *block, int32_t *mix_buffer) {
+    FreqData v = make_voice(BENCH_FREQ_HZ);
+
+    uint64_t start = time_us_64();
+    for (int b = 0; b < BENCH_BLOCKS; b++) {
+        fn(&v, block, mix_buffer, O_BUFFER_SIZE);
+    }
+    uint64_t elapsed_us = time_us_64() - start;
+
+    float cycles = (float)elapsed_us * ((float)clock_get_hz(clk_sys) / 1e6f);
+    return cycles / (float)(BENCH_BLOCKS * O_BUFFER_SIZE);
+}
+
+// Ratio of the tone to the largest spur, in dB
+static float sfdr_db(osc_kernel_fn fn, const OscBlock *block, int32_t *mix_buffer,
+                     float *fft_in, kiss_fft_cpx *fft_out, kiss_fftr_cfg cfg) {
+    FreqData v = make_voice(BENCH_FREQ_HZ);
+    memset(mix_buffer, 0, SFDR_FFT_LEN * sizeof(int32_t));
+    for (int off = 0; off < SFDR_FFT_LEN; off += O_BUFFER_SIZE) {
+        fn(&v, block, &mix_buffer[off], O_BUFFER_SIZE);
+    }
+
+    // 4-term Blackman-Harris: sidelobes below -92 dB, so leakage doesn't mask spurs
+    for (int i = 0; i < SFDR_FFT_LEN; i++) {
+        float x = (float)TWO_PI * i / SFDR_FFT_LEN;
+        float w = 0.35875f - 0.48829f * cosf(x) + 0.14128f * cosf(2 * x) - 0.01168f * cosf(3 * x);
+        fft_in[i] = (float)mix_buffer[i] * w;
+    }
+    kiss_fftr(cfg, fft_in, fft_out);
+
+    int peak_bin = 0;
+    float peak = 0.0f;
+    for (int k = 1; k <= SFDR_FFT_LEN / 2; k++) {
+        float mag = fft_out[k].r * fft_out[k].r + fft_out[k].i * fft_out[k].i;
+        if (mag > peak) { peak = mag; peak_bin = k; }
+    }
+
+    float spur = 1e-12f;
+    for (int k = SFDR_GUARD_BINS; k <= SFDR_FFT_LEN / 2; k++) {
+        if (abs(k - peak_bin) <= SFDR_GUARD_BINS) continue;
+        float mag = fft_out[k].r * fft_out[k].r + fft_out[k].i * fft_out[k].i;
+        if (mag > spur) spur = mag;
+    }
+    return 10.0f * log10f(peak / spur);
+}
+
+// Every kernel specialization (source x amplitude policy) on the pure-sine table
+static void bench_kernels() {
+    int32_t *mix_buffer = (int32_t *)malloc(SFDR_FFT_LEN * sizeof(int32_t));
+    float *fft_in = (float *)malloc(SFDR_FFT_LEN * sizeof(float));
+    kiss_fft_cpx *fft_out = (kiss_fft_cpx *)malloc((SFDR_FFT_LEN / 2 + 1) * sizeof(kiss_fft_cpx));
+    kiss_fftr_cfg cfg = kiss_fftr_alloc(SFDR_FFT_LEN, 0, NULL, NULL);
+    if (!mix_buffer || !fft_in || !fft_out || !cfg) {
+        printf("[Bench] Kernels: out of memory\n");
+    } else {
+        printf("[Bench] Sine @ %.0f Hz          amp     cycles/sample   SFDR\n", BENCH_FREQ_HZ);
+        for (int src = 0; src < OSC_SOURCE_COUNT; src++) {
+            for (int ramp = 0; ramp <= 1; ramp++) {
+                OscBlock block = make_block(ramp);
+                osc_kernel_fn fn = osc_kernel_for((Osc_Source)src, ramp);
+                printf("[Bench]   %-14s  %-5s  %8.1f    %6.1f dB\n", OSC_SOURCE_NAMES[src], ramp ? "ramp" : "const",
+                       cycles_per_sample(fn, &block, mix_buffer),
+                       sfdr_db(fn, &block, mix_buffer, fft_in, fft_out, cfg));
+            }
+        }
+    }
+    free(cfg);
+    free(fft_out);
+    free(fft_in);
+    free(mix_buffer);
+}
+
+// Quarter-wave sine (SRAM copy, folded) vs. the full-cycle mixed table (SRAM)
+static void bench_sine_lookup() {
+    volatile int32_t sink = 0;
+    float cycles_per_us = (float)clock_get_hz(clk_sys) / 1e6f;
+    float lookups = (float)(LOOKUP_PASSES * WAVETABLE_LEN);
+
+    uint64_t start = time_us_64();
+    for (int p = 0; p < LOOKUP_PASSES; p++) {
+        int32_t acc = 0;
+        for (uint32_t i = 0; i < WAVETABLE_LEN; i++) acc += sine_lookup(i);
+        sink = sink + acc;
+    }
+    float folded = (float)(time_us_64() - start) * cycles_per_us / lookups;
+
+    start = time_us_64();
+    for (int p = 0; p < LOOKUP_PASSES; p++) {
+        int32_t acc = 0;
+        for (uint32_t i = 0; i < WAVETABLE_LEN; i++) acc += current_wave_table[i];
+        sink = sink + acc;
+    }
+    float direct = (float)(time_us_64() - start) * cycles_per_us / lookups;
+    (void)sink;
+
+    printf("[Bench] Sine lookup            cycles/lookup   bytes\n");
+    printf("[Bench]   Quarter wave (SRAM)  %8.1f    %6u\n", folded, (unsigned)sizeof(SINE_QUARTER_TABLE));
+    printf("[Bench]   Full table (SRAM)    %8.1f    %6u\n", direct, (unsigned)(WAVETABLE_LEN * sizeof(int16_t)));
+}
+
+// Wavetable SRAM against the original layout: four source tables and one
+// single-level synth table, all int16_t[WAVETABLE_LEN] in SRAM
+static void bench_wavetable_memory() {
+    WavetableMemory m = get_wavetable_memory();
+    unsigned table = (unsigned)(WAVETABLE_LEN * sizeof(int16_t));
+    unsigned original = 5 * table;
+    unsigned total = m.synth_banks + m.sine_quarter + m.build_scratch + m.fft_plans;
+
+    printf("[Bench] Wavetable SRAM                     bytes\n");
+    printf("[Bench]   Original (4 source + 1 synth)  %6u\n", original);
+    printf("[Bench]   Source tables moved to flash   %6d\n", -(int)(4 * table));
+    printf("[Bench]   Synth banks (2 x %d levels)     %6u\n", WAVETABLE_MIP_LEVELS, (unsigned)m.synth_banks);
+    printf("[Bench]   Quarter-wave sine copy         %6u\n", (unsigned)m.sine_quarter);
+    printf("[Bench]   Mip build scratch              %6u\n", (unsigned)m.build_scratch);
+    printf("[Bench]   Mip FFT plans (heap)           %6u\n", (unsigned)m.fft_plans);
+    printf("[Bench]   Now                            %6u (%+d vs original)\n", total, (int)total - (int)original);
+}
+
+// Previous final stage, for reference
+static void hard_clip(int32_t *mix_buffer, uint num_samples) {
+    for (uint i = 0; i < num_samples; i++) {
+        int32_t val = mix_buffer[i];
+        if (val > 32767) val = 32767;
+        else if (val < -32767) val = -32767;
+        mix_buffer[i] = val;
+    }
+}
+
+// Times one output stage on a dense chord (peaks well above full scale).
+// Each pass restores the block first; that copy is included in every row.
+static float stage_cycles_per_sample(void (*stage)(int32_t *, uint), const int32_t *chord, int32_t *work) {
+    uint64_t start = time_us_64();
+    for (int b = 0; b < BENCH_BLOCKS; b++) {
+        memcpy(work, chord, O_BUFFER_SIZE * sizeof(int32_t));
+        stage(work, O_BUFFER_SIZE);
+    }
+    uint64_t elapsed_us = time_us_64() - start;
+    float cycles = (float)elapsed_us * ((float)clock_get_hz(clk_sys) / 1e6f);
+    return cycles / (float)(BENCH_BLOCKS * O_BUFFER_SIZE);
+}
+
+static void bench_output_stage() {
+    static int32_t chord[O_BUFFER_SIZE];
+    static int32_t work[O_BUFFER_SIZE];
+
+    // E major-ish chord, every voice at the new per-voice maximum
+    const float freqs[CHORD_NOTES] = { 82.4f, 123.5f, 164.8f, 207.7f, 246.9f, 329.6f };
+    memset(chord, 0, sizeof(chord));
+    for (int n = 0; n < CHORD_NOTES; n++) {
+        for (int i = 0; i < O_BUFFER_SIZE; i++) {
+            chord[i] += (int32_t)((32767 >> VOICE_HEADROOM_SHIFT) * sinf((float)TWO_PI * freqs[n] * i / FS_O));
+        }
+    }
+
+    printf("[Bench] Output stage           cycles/sample\n");
+    printf("[Bench]   Hard clip            %8.1f\n", stage_cycles_per_sample(hard_clip, chord, work));
+    set_output_limiter(false);
+    printf("[Bench]   Soft clip            %8.1f\n", stage_cycles_per_sample(output_stage_process, chord, work));
+    set_output_limiter(true);
+    float limited = stage_cycles_per_sample(output_stage_process, chord, work);
+    printf("[Bench]   Limiter + soft clip  %8.1f  (gain %.2f)\n", limited, output_limiter_gain() / 4096.0f);
+
+    // Leave the live output stage clean (main.cpp sets the limiter mode)
+    set_output_limiter(false);
+    output_stage_reset();
+}
+
+// --- Public Functions ---
+
+void run_benchmarks() {
+    // The synth table and output stage are shared with the live output
+    if (get_output_stats()->stream_start_us != 0) {
+        printf("[Bench] Skipped: audio is already running\n");
+        return;
+    }
+
+    printf("=== Benchmarks (clk_sys %lu MHz) ===\n", (unsigned long)(clock_get_hz(clk_sys) / 1000000));
+
+    // The table kernels are measured on the pure-sine mix, same as the recursive one
+    set_synth_table(1.0f, 0.0f, 0.0f, 0.0f);
+    flush_synth_table();
+    bench_kernels();
+    bench_sine_lookup();
+    bench_wavetable_memory();
+    bench_output_stage();
+}
@@ -0,0 +1,20 @@
+/**
+ * File: benchmarks.hpp
+ * Description: On-target micro-benchmarks for the synthesis kernels.
+ * Results are printed over stdio; enable with RUN_BENCHMARKS in main.cpp.
+ */
+
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+/**
+ * @brief Runs all benchmarks and prints the results.
+ * Needs init_wavetables() to have run, and must run before audio starts
+ * (it returns without measuring once the output stream is running): it
+ * replaces the synth table with a pure sine (flushed, no crossfade) and
+ * drives the shared output stage, which it leaves reset with the limiter
+ * off. The caller restores the live timbre and output stage settings.
+ */
+void run_benchmarks();
+
+#endif // BENCHMARKS_H
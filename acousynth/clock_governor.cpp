@@ -0,0 +1,182 @@
+/**
+ * File: clock_governor.cpp
+ * Description: clk_sys profile switching and the load-based decision.
+ *
+ * Switch, with interrupts off on the audio core:
+ *   1. clk_sys divider (the divider changes glitch-free on a running clock)
+ *   2. I2S PIO divider = pio_base_div / sys_div, so PLL_SYS / (sys_div *
+ *      pio_div) is the same in every profile
+ * Both writes are a few cycles apart, far less than one PIO clock period.
+ * Raising the core voltage (boost) is done by the decision first; the
+ * switch waits GOV_VREG_SETTLE_US for it. Lowering it follows the switch.
+ */
+
+#include "clock_governor.hpp"
+#include "output_config.hpp"
+#include "hardware/clocks.h"
+#include "hardware/pio.h"
+#include "hardware/sync.h"
+#include <stdio.h>
+
+// pico_audio_i2s runs its state machine on pio0 unless told otherwise
+#if defined(PICO_AUDIO_I2S_PIO) && (PICO_AUDIO_I2S_PIO == 1)
+#define GOV_I2S_PIO pio1
+#else
+#define GOV_I2S_PIO pio0
+#endif
+
+static const GovProfileDef PROFILES[GOV_NUM_PROFILES] = {
+    { "eco",     4, VREG_VOLTAGE_DEFAULT },
+    { "nominal", 2, VREG_VOLTAGE_DEFAULT },
+    { "boost",   1, VREG_VOLTAGE_1_20 },
+};
+
+// --- Governor State ---
+static bool governor_enabled = false;
+static bool i2s_attached = false;
+static bool i2s_synced = false;                 // Divider rewritten after pico_audio_i2s set its own
+static uint32_t pio_base_div = 0;               // PIO divider (16.8) at sys_div = 1
+static enum vreg_voltage vreg_now = VREG_VOLTAGE_DEFAULT;
+static uint32_t vreg_raised_us = 0;
+static volatile int pending_profile = -1;       // Set by the decision, applied by the audio side
+static uint32_t last_underruns = 0;
+static uint32_t calm_start_us = 0;              // Since when a step down would have fit
+static volatile uint32_t peak_render_pct = 0;   // Worst audio block load since the last decision
+static GovStats gov_stats;
+
+// --- Helper Functions ---
+
+static void set_vreg(enum vreg_voltage v) {
+    if (v == vreg_now) return;
+    vreg_set_voltage(v);
+    if (v > vreg_now) vreg_raised_us = time_us_32();
+    vreg_now = v;
+}
+
+static void apply_profile(int p) {
+    uint32_t sys_div = PROFILES[p].sys_div;
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    // 1. clk_sys divider
+    clocks_hw->clk[clk_sys].div = sys_div << CLOCKS_CLK_SYS_DIV_INT_LSB;
+    // 2. Same PIO clock as before
+    if (i2s_attached) {
+        uint32_t pio_div = pio_base_div / sys_div;
+        pio_sm_set_clkdiv_int_frac(GOV_I2S_PIO, PIO_NUM, (uint16_t)(pio_div >> 8), (uint8_t)(pio_div & 0xff));
+    }
+    restore_interrupts(irq_state);
+
+    clock_set_reported_hz(clk_sys, GOV_PLL_KHZ * KHZ / sys_div);
+    gov_stats.profile = p;
+    gov_stats.sys_hz = GOV_PLL_KHZ * KHZ / sys_div;
+}
+
+// --- Public Functions ---
+
+void governor_init(Gov_Profile start) {
+    // 1. Voltage for the fastest profile, then lock the PLL
+    set_vreg(PROFILES[GOV_BOOST].vreg);
+    sleep_us(GOV_VREG_SETTLE_US);
+    set_sys_clock_khz(GOV_PLL_KHZ, true);
+
+    // 2. Peripherals off clk_sys: clk_peri to PLL_USB (48 MHz), like clk_adc and clk_usb
+    clock_configure(clk_peri, 0, CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB,
+                    48 * MHZ, 48 * MHZ);
+
+    // 3. Starting profile (nothing is clocked from the PIO yet)
+    apply_profile(start);
+    set_vreg(PROFILES[start].vreg);
+    calm_start_us = time_us_32();
+    governor_enabled = true;
+
+    printf("[Gov] PLL %lu MHz, start %s (%lu MHz), ADC clock %lu Hz\n",
+           (unsigned long)(GOV_PLL_KHZ / 1000), PROFILES[start].name,
+           (unsigned long)(gov_stats.sys_hz / MHZ), (unsigned long)clock_get_hz(clk_adc));
+}
+
+void governor_start_i2s() {
+    if (!governor_enabled) return;
+
+    // Nominal PIO divider at sys_div = 1 (as pico_audio_i2s computes it,
+    // sys_hz * 4 / fs in 16.8), rounded to a multiple of every sys_div
+    uint64_t base = (uint64_t)GOV_PLL_KHZ * KHZ * 4 / FS_O;
+    pio_base_div = (uint32_t)((base + GOV_DIV_LCM / 2) / GOV_DIV_LCM * GOV_DIV_LCM);
+    i2s_attached = true;
+    apply_profile(gov_stats.profile);
+
+    printf("[Gov] I2S PIO divider %lu/256 at %lu MHz (%.2f Hz)\n",
+           (unsigned long)(pio_base_div / PROFILES[gov_stats.profile].sys_div),
+           (unsigned long)(gov_stats.sys_hz / MHZ),
+           (double)GOV_PLL_KHZ * KHZ * 4.0 / (double)pio_base_div);
+}
+
+void governor_update(uint32_t busy_pct) {
+    if (!governor_enabled) return;
+    uint32_t now = time_us_32();
+
+    // 1. Load: the worse of the audio blocks and the main loop
+    uint32_t load = peak_render_pct;
+    peak_render_pct = 0;
+    if (busy_pct > load) load = busy_pct;
+    gov_stats.load_pct = load;
+
+    int current = gov_stats.profile;
+    if (pending_profile >= 0) return; // Still waiting for a block boundary
+
+    // 2. Once the stream runs, the library has set its own PIO divider:
+    // re-apply the current profile to put the exact one back
+    if (i2s_attached && !i2s_synced && get_output_stats()->stream_start_us != 0) {
+        i2s_synced = true;
+        pending_profile = current;
+        return;
+    }
+
+    // 3. Lower the voltage a step down left too high
+    if (PROFILES[current].vreg < vreg_now) set_vreg(PROFILES[current].vreg);
+
+    // 4. Decide
+    uint32_t underruns = get_output_stats()->underruns;
+    int target = current;
+    if (underruns != last_underruns) {
+        target = GOV_BOOST; // Audio ran dry: straight to the top
+    } else if (load > GOV_UP_LOAD_PCT && current < GOV_BOOST) {
+        target = current + 1;
+    } else if (current > GOV_ECO) {
+        // Step down once the slower profile would have stayed below the threshold for a while
+        uint32_t slower_load = load * PROFILES[current - 1].sys_div / PROFILES[current].sys_div;
+        if (slower_load >= GOV_DOWN_LOAD_PCT) {
+            calm_start_us = now;
+        } else if (now - calm_start_us >= GOV_DOWN_HOLD_MS * 1000) {
+            target = current - 1;
+        }
+    }
+    last_underruns = underruns;
+
+    if (target == current) return;
+
+    // 5. Voltage first when speeding up; the audio side does the switch
+    if (PROFILES[target].vreg > vreg_now) set_vreg(PROFILES[target].vreg);
+    calm_start_us = now;
+    pending_profile = target;
+}
+
+void __not_in_flash_func(governor_block_boundary)(uint32_t render_us, uint num_samples) {
+    if (!governor_enabled) return;
+
+    // Worst block load at the current clock
+    uint32_t pct = render_us * 100 / o_block_us(num_samples);
+    if (pct > peak_render_pct) peak_render_pct = pct;
+
+    int p = pending_profile;
+    if (p < 0) return;
+    if (PROFILES[p].vreg > PROFILES[gov_stats.profile].vreg &&
+        time_us_32() - vreg_raised_us < GOV_VREG_SETTLE_US) return;
+
+    if (p != gov_stats.profile) gov_stats.switches++;
+    apply_profile(p);
+    pending_profile = -1;
+}
+
+const GovStats* get_governor_stats() {
+    return &gov_stats;
+}
@@ -0,0 +1,94 @@
+/**
+ * File: clock_governor.hpp
+ * Description: System clock governor driven by DSP load.
+ *
+ * PLL_SYS runs at a fixed GOV_PLL_KHZ and clk_sys is stepped between
+ * profiles by its own integer divider (250 / 125 / 62.5 MHz), so a switch
+ * never re-locks the PLL or passes clk_sys through clk_ref. The I2S PIO
+ * divider is rewritten in the same critical section, scaled so the PIO
+ * clock (and so the output sample rate) is identical in every profile.
+ * The ADC (clk_adc), USB and the timer run from PLL_USB / clk_ref and are
+ * not affected; clk_peri is moved to PLL_USB at init for the same reason.
+ *
+ * The decision is taken every GOV_INTERVAL_MS from the worst audio render
+ * load and the main loop's busy time; the switch itself is applied by the
+ * audio side right after a rendered block is queued.
+ *
+ * pico_audio_i2s programs its own PIO divider (sys_clk * 4 / fs, unrounded)
+ * on its first buffer take once the stream runs. The governor writes its
+ * divider back at the first decision after that, so from then on the
+ * output rate is the same in every profile.
+ */
+
+#ifndef CLOCK_GOVERNOR_H
+#define CLOCK_GOVERNOR_H
+
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "hardware/vreg.h"
+
+// --- Clock Profiles ---
+constexpr uint32_t GOV_PLL_KHZ = 250000;        // PLL_SYS: 1500 MHz VCO / 6
+
+typedef enum {
+    GOV_ECO = 0,                // 62.5 MHz
+    GOV_NOMINAL,                // 125 MHz (the SDK default)
+    GOV_BOOST,                  // 250 MHz (overclocked)
+    GOV_NUM_PROFILES
+} Gov_Profile;
+
+typedef struct GovProfileDef {
+    const char *name;
+    uint32_t sys_div;           // clk_sys = PLL_SYS / sys_div
+    enum vreg_voltage vreg;     // Core voltage the profile needs
+} GovProfileDef;
+
+// Every sys_div must divide GOV_DIV_LCM (keeps the PIO clock exact)
+constexpr uint32_t GOV_DIV_LCM = 4;
+
+// --- Control ---
+constexpr uint32_t GOV_INTERVAL_MS     = 200;   // Decision period
+constexpr uint32_t GOV_UP_LOAD_PCT     = 70;    // Step up above this load
+constexpr uint32_t GOV_DOWN_LOAD_PCT   = 55;    // Step down if the slower profile would stay below this...
+constexpr uint32_t GOV_DOWN_HOLD_MS    = 3000;  // ...for this long
+constexpr uint32_t GOV_VREG_SETTLE_US  = 1000;  // Wait after raising the core voltage
+
+typedef struct GovStats {
+    int profile;                // Gov_Profile in use
+    uint32_t sys_hz;            // Current clk_sys
+    uint32_t load_pct;          // Load seen at the last decision
+    uint32_t switches;          // Profile switches since boot
+} GovStats;
+
+/**
+ * @brief Locks PLL_SYS at GOV_PLL_KHZ (raising the core voltage first) and
+ * starts in the given profile. Call at boot, before the audio output is set up.
+ */
+void governor_init(Gov_Profile start);
+
+/**
+ * @brief Takes over the I2S PIO divider (scaled per profile from now on).
+ * Call after connect_o_buffers(), before start_o_stream().
+ */
+void governor_start_i2s();
+
+/**
+ * @brief Load-based decision. Runs every GOV_INTERVAL_MS on core0.
+ * @param busy_pct Main loop busy time over the last interval
+ */
+void governor_update(uint32_t busy_pct);
+
+/**
+ * @brief Records the load of a block and applies a pending profile switch.
+ * Called by the output after every rendered block is queued; cheap otherwise.
+ * @param render_us   Time spent rendering the block
+ * @param num_samples Block length
+ */
+void governor_block_boundary(uint32_t render_us, uint num_samples);
+
+/**
+ * @brief Returns the governor state.
+ */
+const GovStats* get_governor_stats();
+
+#endif // CLOCK_GOVERNOR_H
@@ -0,0 +1,67 @@
+/**
+ * File: const_math.hpp
+ * Description: constexpr replacements for sin/cos/exp.
+ * Lets lookup tables be computed by the compiler and placed in flash
+ * (.rodata) instead of being generated in soft-float at boot.
+ * Only for compile-time use: these are Taylor series, not fast code.
+ */
+
+#ifndef CONST_MATH_H
+#define CONST_MATH_H
+
+#include "macros.hpp"
+
+constexpr double CE_PI = TWO_PI / 2.0;
+
+// sin(x), any x. Reduced to [-pi, pi], then Taylor to x^31.
+constexpr double ce_sin(double x) {
+    while (x > CE_PI)  x -= TWO_PI;
+    while (x < -CE_PI) x += TWO_PI;
+
+    double term = x;
+    double sum = x;
+    for (int k = 1; k < 16; k++) {
+        term *= -x * x / (double)((2 * k) * (2 * k + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double ce_cos(double x) {
+    return ce_sin(x + CE_PI / 2.0);
+}
+
+constexpr double ce_abs(double x) {
+    return (x < 0.0) ? -x : x;
+}
+
+// exp(x), |x| up to ~40. Halved until small, Taylor, then squared back.
+constexpr double ce_exp(double x) {
+    int halvings = 0;
+    while (x > 0.5 || x < -0.5) {
+        x *= 0.5;
+        halvings++;
+    }
+
+    double term = 1.0;
+    double sum = 1.0;
+    for (int k = 1; k < 14; k++) {
+        term *= x / (double)k;
+        sum += term;
+    }
+
+    for (int i = 0; i < halvings; i++) {
+        sum *= sum;
+    }
+    return sum;
+}
+
+// Round-to-nearest into Q15, saturating
+constexpr int16_t ce_to_q15(double v) {
+    double scaled = v * 32767.0;
+    if (scaled > 32767.0) return 32767;
+    if (scaled < -32767.0) return -32767;
+    return (int16_t)(scaled >= 0.0 ? scaled + 0.5 : scaled - 0.5);
+}
+
+#endif // CONST_MATH_H
@@ -0,0 +1,104 @@
+/**
+ * File: control_queue.cpp
+ * Description: Frame pool and index rings for the analysis -> synthesis handoff.
+ *
+ * Each ring has one writer per index: the producer advances head, the
+ * consumer advances tail. A data memory barrier orders the frame contents
+ * before the head update, so the consumer never sees a half-written frame.
+ */
+
+#include "control_queue.hpp"
+#include "hardware/sync.h" // __dmb
+#include <string.h>
+
+// Ring capacity (power of two). Every frame fits in one ring at once.
+constexpr uint32_t RING_SIZE = 4;
+static_assert(RING_SIZE > CONTROL_FRAMES, "Index ring must hold every frame");
+
+typedef struct IndexRing {
+    volatile uint32_t head;     // Written by the producer only
+    volatile uint32_t tail;     // Written by the consumer only
+    volatile uint8_t slot[RING_SIZE];
+} IndexRing;
+
+// --- Shared State ---
+static ControlFrame frames[CONTROL_FRAMES];
+static IndexRing published;     // Analysis -> Synthesis
+static IndexRing released;      // Synthesis -> Analysis
+
+// --- Analysis-Side State ---
+static uint8_t free_list[CONTROL_FRAMES];
+static int free_count = 0;
+static volatile uint32_t dropped = 0;
+
+// --- Ring Helpers ---
+
+static inline void ring_push(IndexRing *r, uint8_t idx) {
+    uint32_t head = r->head;
+    r->slot[head % RING_SIZE] = idx;
+    __dmb(); // Frame and slot are visible before the new head
+    r->head = head + 1;
+}
+
+static inline bool ring_pop(IndexRing *r, uint8_t *idx) {
+    uint32_t tail = r->tail;
+    if (tail == r->head) return false;
+    __dmb(); // Slot is read after the head that published it
+    *idx = r->slot[tail % RING_SIZE];
+    r->tail = tail + 1;
+    return true;
+}
+
+static inline uint8_t frame_index(const ControlFrame *frame) {
+    return (uint8_t)(frame - frames);
+}
+
+// --- Public Functions ---
+
+void control_queue_init() {
+    memset(frames, 0, sizeof(frames));
+    published.head = published.tail = 0;
+    released.head = released.tail = 0;
+    for (int i = 0; i < CONTROL_FRAMES; i++) {
+        free_list[i] = (uint8_t)i;
+    }
+    free_count = CONTROL_FRAMES;
+    dropped = 0;
+}
+
+ControlFrame* control_frame_acquire() {
+    // Collect what the synthesis has handed back
+    uint8_t idx;
+    while (ring_pop(&released, &idx)) {
+        free_list[free_count++] = idx;
+    }
+
+    if (free_count == 0) {
+        dropped = dropped + 1;
+        return NULL;
+    }
+    return &frames[free_list[--free_count]];
+}
+
+void control_frame_publish(ControlFrame *frame) {
+    ring_push(&published, frame_index(frame));
+}
+
+const ControlFrame* __not_in_flash_func(control_frame_receive)() {
+    // Keep only the newest frame; anything it supersedes goes straight back
+    uint8_t idx;
+    const ControlFrame *newest = NULL;
+    while (ring_pop(&published, &idx)) {
+        if (newest) control_frame_release(newest);
+        newest = &frames[idx];
+    }
+    return newest;
+}
+
+void __not_in_flash_func(control_frame_release)(const ControlFrame *frame) {
+    ring_push(&released, frame_index(frame));
+}
+
+uint32_t control_frames_dropped() {
+    return dropped;
+}
@@ -0,0 +1,74 @@
+/**
+ * File: control_queue.hpp
+ * Description: Lock-free handoff of analysis results to the synthesis core.
+ *
+ * The analysis fills a ControlFrame (one VoiceControl per bin) and publishes
+ * it; the synthesis applies the newest frame at its next block boundary.
+ * Frames live in a small pool in shared RAM and only their indices move,
+ * through two single-producer/single-consumer rings:
+ *   analysis -> synthesis: published frames
+ *   synthesis -> analysis: frames released after they were applied
+ * A frame has exactly one owner at a time, so neither side takes a lock or
+ * waits on the other. Works the same with both sides on one core.
+ */
+
+#ifndef CONTROL_QUEUE_H
+#define CONTROL_QUEUE_H
+
+#include <stdint.h>
+#include "macros.hpp"
+
+// Frames in the pool: one being filled, one in flight, one spare.
+// The analysis publishes every ~100 ms and the synthesis takes frames every
+// block, so the spare only runs out if the synthesis core has stalled.
+constexpr int CONTROL_FRAMES = 3;
+
+// --- Per-Bin Control (Analysis -> Synthesis) ---
+typedef struct VoiceControl {
+    bool play;                  // Gate flag
+    int8_t env_phase;           // Env_Phase of the analysed amplitude
+    int16_t amp;                // Target Amplitude (Q15)
+    float string_freq_hz;       // Refined peak frequency
+    uint32_t string_phase;      // String phase (DDS units, sine convention) at string_phase_us
+    uint32_t string_phase_us;   // Time the string had that phase
+    bool phase_valid;           // Measurement belongs to the current peak
+} VoiceControl;
+
+typedef struct ControlFrame {
+    VoiceControl voice[NUM_FREQS];
+} ControlFrame;
+
+/**
+ * @brief Resets the pool. Call before the synthesis core is started.
+ */
+void control_queue_init();
+
+/**
+ * @brief Analysis side: takes a free frame to fill.
+ * @return NULL if every frame is still queued (the frame is dropped)
+ */
+ControlFrame* control_frame_acquire();
+
+/**
+ * @brief Analysis side: hands a filled frame to the synthesis.
+ */
+void control_frame_publish(ControlFrame *frame);
+
+/**
+ * @brief Synthesis side: newest published frame, or NULL if none arrived
+ * since the last call. Older unread frames are released on the way.
+ * The frame must be returned with control_frame_release().
+ */
+const ControlFrame* control_frame_receive();
+
+/**
+ * @brief Synthesis side: returns a frame to the analysis.
+ */
+void control_frame_release(const ControlFrame *frame);
+
+/**
+ * @brief Frames the analysis could not publish (no free frame).
+ */
+uint32_t control_frames_dropped();
+
+#endif // CONTROL_QUEUE_H
@@ -0,0 +1,160 @@
+/**
+ * File: envelope.cpp
+ * Description: ADSR state machine, stepped once per block.
+ *
+ * Every segment runs along the same exponential curve from the level it
+ * started at to its end level, so a retrigger or early release starts from
+ * wherever the voice currently is (no click). The segment end is re-read
+ * every block, so attack and decay follow the live analysed amplitude.
+ */
+
+#include "envelope.hpp"
+#include "const_math.hpp"
+#include <array>
+#include <math.h>
+#include <stdio.h>
+
+// --- Constants ---
+constexpr double ENV_CURVE_K = 4.0;     // Curvature (fast start, slow settle); 0 would be linear
+constexpr uint32_t SEGMENT_DONE = 0xFFFFFFFFu;
+
+// --- Segment Curve (Flash) ---
+static constexpr std::array<int16_t, ENV_CURVE_LEN + 1> make_env_curve() {
+    std::array<int16_t, ENV_CURVE_LEN + 1> t{};
+    double norm = 1.0 - ce_exp(-ENV_CURVE_K);
+    for (int i = 0; i <= ENV_CURVE_LEN; i++) {
+        double x = (double)i / ENV_CURVE_LEN;
+        t[i] = ce_to_q15((1.0 - ce_exp(-ENV_CURVE_K * x)) / norm);
+    }
+    return t;
+}
+
+static constexpr std::array<int16_t, ENV_CURVE_LEN + 1> RAM_TABLE("env_curve") ENV_CURVE = make_env_curve();
+
+// Per-sample segment progress (Q32: 2^32 = whole segment). 0 = instant.
+static constexpr uint32_t segment_inc(uint16_t ms) {
+    if (ms == 0) return 0;
+    double inc = two32 / ((double)ms * FS_O / 1000.0);
+    return (inc >= two32) ? SEGMENT_DONE : (uint32_t)inc;
+}
+
+// --- Runtime Parameters ---
+static uint32_t attack_inc  = segment_inc(ENV_DEFAULT_ATTACK_MS);
+static uint32_t decay_inc   = segment_inc(ENV_DEFAULT_DECAY_MS);
+static uint32_t release_inc = segment_inc(ENV_DEFAULT_RELEASE_MS);
+static constexpr uint32_t fast_release_inc = segment_inc(ENV_FAST_RELEASE_MS);
+static int16_t  sustain_level = ENV_DEFAULT_SUSTAIN;
+
+// Sustain follower gain per block (Q15), cached for the current block length
+static uint    track_block_len = 0;
+static int32_t track_coeff_q15 = 0;
+
+// --- Helper Functions ---
+
+static inline void start_segment(FreqData *v, Env_Stage stage) {
+    v->env_stage = stage;
+    v->env_start = v->current_amp;
+    v->env_pos = 0;
+}
+
+// Advances the segment by one block. Returns true once it has completed.
+static inline bool segment_step(FreqData *v, uint32_t inc, uint num_samples) {
+    uint64_t pos = (uint64_t)v->env_pos + (uint64_t)inc * num_samples;
+    if (inc == 0 || pos >= SEGMENT_DONE) {
+        v->env_pos = SEGMENT_DONE;
+        return true;
+    }
+    v->env_pos = (uint32_t)pos;
+    return false;
+}
+
+static inline int16_t segment_level(int16_t start, int16_t end, uint32_t pos) {
+    int32_t c = ENV_CURVE[pos >> (32 - ENV_CURVE_BITS)];
+    return (int16_t)(start + (((int32_t)(end - start) * c) >> 15));
+}
+
+// 1 - e^(-n / tau), recomputed only when the block length changes
+static int32_t track_coeff(uint num_samples) {
+    if (num_samples != track_block_len) {
+        float tau_samples = ENV_TRACK_MS * (float)FS_O / 1000.0f;
+        track_coeff_q15 = (int32_t)((1.0f - expf(-(float)num_samples / tau_samples)) * 32767.0f);
+        track_block_len = num_samples;
+    }
+    return track_coeff_q15;
+}
+
+// --- Public Functions ---
+
+void set_synth_env(uint16_t attack_ms, uint16_t decay_ms, int16_t sustain, uint16_t release_ms) {
+    attack_inc = segment_inc(attack_ms);
+    decay_inc = segment_inc(decay_ms);
+    release_inc = segment_inc(release_ms);
+    sustain_level = (sustain < 0) ? 0 : sustain;
+
+    printf("[Envelope] A: %u ms, D: %u ms, S: %.2f, R: %u ms\n",
+           attack_ms, decay_ms, sustain_level / 32767.0f, release_ms);
+}
+
+void env_reset(FreqData *v) {
+    v->current_amp = 0;
+    v->env_stage = ENV_IDLE;
+    v->env_start = 0;
+    v->env_pos = 0;
+    v->env_last_phase = SUSTAIN;
+}
+
+int16_t __not_in_flash_func(env_advance)(FreqData *v, int16_t target_amp, bool gate, bool fast_release, uint num_samples) {
+    bool open = (v->env_stage != ENV_IDLE && v->env_stage != ENV_RELEASE);
+    bool repluck = (v->env_phase == ATTACK && v->env_last_phase != ATTACK);
+    v->env_last_phase = (int8_t)v->env_phase;
+
+    int16_t sustain_target = (int16_t)(((int32_t)target_amp * sustain_level) >> 15);
+
+    // 1. Gate Edges
+    if (gate && (!open || (repluck && v->env_stage != ENV_ATTACK))) {
+        start_segment(v, ENV_ATTACK);
+    } else if (!gate && open) {
+        start_segment(v, ENV_RELEASE);
+    }
+
+    // 2. Segment Step (control rate)
+    switch (v->env_stage) {
+        case ENV_ATTACK:
+            if (segment_step(v, attack_inc, num_samples)) {
+                v->current_amp = target_amp;
+                start_segment(v, ENV_DECAY);
+            } else {
+                v->current_amp = segment_level(v->env_start, target_amp, v->env_pos);
+            }
+            break;
+
+        case ENV_DECAY:
+            if (segment_step(v, decay_inc, num_samples)) {
+                v->current_amp = sustain_target;
+                v->env_stage = ENV_SUSTAIN;
+            } else {
+                v->current_amp = segment_level(v->env_start, sustain_target, v->env_pos);
+            }
+            break;
+
+        case ENV_SUSTAIN:
+            // Follow the guitar's own decay (one-pole, block rate)
+            v->current_amp += (int16_t)(((int32_t)(sustain_target - v->current_amp) * track_coeff(num_samples)) >> 15);
+            break;
+
+        case ENV_RELEASE:
+            if (segment_step(v, fast_release ? fast_release_inc : release_inc, num_samples)) {
+                v->current_amp = 0;
+                v->env_stage = ENV_IDLE;
+            } else {
+                v->current_amp = segment_level(v->env_start, 0, v->env_pos);
+            }
+            break;
+
+        default:
+            v->current_amp = 0;
+            break;
+    }
+
+    return v->current_amp;
+}
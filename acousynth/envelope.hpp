@@ -0,0 +1,75 @@
+/**
+ * File: envelope.hpp
+ * Description: Per-voice ADSR envelope generator in Q15 fixed point.
+ * Segments advance once per output block (control rate) along a precomputed
+ * exponential curve; the render kernels only ramp linearly between the
+ * block-start and block-end levels (one add per sample).
+ */
+
+#ifndef ENVELOPE_H
+#define ENVELOPE_H
+
+#include <stdint.h>
+#include "macros.hpp"
+#include "input_config.hpp" // For FreqData
+
+// --- Envelope Stages ---
+typedef enum {
+    ENV_IDLE    = 0,  // Silent, voice not rendered
+    ENV_ATTACK  = 1,  // Rising to the analysed amplitude
+    ENV_DECAY   = 2,  // Falling from the peak to the sustain level
+    ENV_SUSTAIN = 3,  // Tracking the analysed amplitude x sustain
+    ENV_RELEASE = 4   // Falling to silence after the gate closed
+} Env_Stage;
+
+// --- Defaults ---
+constexpr uint16_t ENV_DEFAULT_ATTACK_MS  = 30;
+constexpr uint16_t ENV_DEFAULT_DECAY_MS   = 100;
+constexpr int16_t  ENV_DEFAULT_SUSTAIN    = 32767; // Q15 share of the analysed amplitude
+constexpr uint16_t ENV_DEFAULT_RELEASE_MS = 100;
+// Time constant of the sustain follower (same as the old Kp = 0.002 at 44.1 kHz)
+constexpr float    ENV_TRACK_MS           = 11.0f;
+// Release used for voices that lost their slot to the polyphony limit
+constexpr uint16_t ENV_FAST_RELEASE_MS    = 5;
+
+// Segment curve: ENV_CURVE_LEN + 1 points of (1 - e^(-k x)) / (1 - e^(-k)), Q15
+constexpr int ENV_CURVE_BITS = 8;
+constexpr int ENV_CURVE_LEN  = 1 << ENV_CURVE_BITS;
+
+/**
+ * @brief Sets the ADSR parameters. Safe to call at runtime; voices pick up
+ * the new rates at their next block.
+ * @param attack_ms  Attack time (0 = instant)
+ * @param decay_ms   Decay time from the peak to the sustain level
+ * @param sustain    Sustain level as a Q15 share of the analysed amplitude
+ * @param release_ms Release time after the gate closes
+ */
+void set_synth_env(uint16_t attack_ms, uint16_t decay_ms, int16_t sustain, uint16_t release_ms);
+
+/**
+ * @brief Clears a voice's envelope state.
+ */
+void env_reset(FreqData *v);
+
+/**
+ * @brief Advances a voice's envelope by one block (control rate).
+ * Gate edges start attack/release; an ATTACK edge of env_phase from the
+ * analysis retriggers the attack (re-pluck).
+ * On return v->current_amp holds the level at the end of the block.
+ * @param target_amp   Analysed amplitude (Q15)
+ * @param gate         Voice should be sounding
+ * @param fast_release Use ENV_FAST_RELEASE_MS instead of the release time
+ * @param num_samples  Samples in the block
+ * @return Level at the end of the block (Q15)
+ */
+int16_t env_advance(FreqData *v, int16_t target_amp, bool gate, bool fast_release, uint num_samples);
+
+/**
+ * @brief Per-sample ramp from start_level to end_level over one block.
+ * Levels are carried in Q16.16 (level << 16) by the render kernels.
+ */
+static inline int32_t env_ramp_step(int16_t start_level, int16_t end_level, uint num_samples) {
+    return ((int32_t)(end_level - start_level) * 65536) / (int32_t)num_samples;
+}
+
+#endif // ENVELOPE_H
@@ -0,0 +1,211 @@
+/**
+ * File: ifft_synth.cpp
+ * Description: Inverse-FFT overlap-add resynthesis.
+ *
+ * Each frame is a Hann-windowed sum of sinusoids, centered on the end of the
+ * current output block. A windowed sinusoid is concentrated in the few bins
+ * around its frequency (Hann main lobe plus first sidelobes), so each
+ * harmonic of a partial costs 8 complex adds regardless of its frequency. With 50% overlap the Hann windows sum to 1, which gives a
+ * continuous output as long as each partial's phase advances by one hop per
+ * frame - the same phase the oscillator bank would have, so the two engines
+ * can be swapped without a discontinuity.
+ */
+
+#include "ifft_synth.hpp"
+#include "const_math.hpp"
+#include "libs/kissfft/kiss_fftr.h"
+#include <array>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// --- Constants ---
+constexpr int   KERNEL_HALF_WIDTH = 4;    // Main lobe + first sidelobes: +/-4 bins
+constexpr int   KERNEL_OVERSAMPLE = 32;   // Kernel table points per bin
+constexpr int   KERNEL_LEN = KERNEL_HALF_WIDTH * KERNEL_OVERSAMPLE + 1;
+constexpr int   NUM_BINS = IFFT_SIZE / 2 + 1;
+constexpr int   IFFT_CPX = IFFT_SIZE / 2;  // Complex FFT length inside kiss_fftri
+constexpr float PHASE_TO_RAD = (float)(TWO_PI / two32);
+constexpr float INC_TO_BIN = (float)IFFT_SIZE / (float)two32;
+
+// --- Internal State ---
+static kiss_fftr_cfg ifft_cfg;
+static kiss_fft_cpx spectrum[NUM_BINS];
+static float frame[IFFT_SIZE];
+static float tail[IFFT_HOP];
+static TimbreHarmonics timbre;   // Harmonics for the current frame
+
+// --- Precomputed Tables ---
+// Computed by the compiler (const_math.hpp) and copied to SRAM at boot.
+
+// Spectrum of a centered periodic Hann window, normalized to the window mean (0.5 at x=0)
+static constexpr double hann_kernel(double x) {
+    if (ce_abs(x) < 1e-6) return 0.5;
+    if (ce_abs(ce_abs(x) - 1.0) < 1e-6) return 0.25;
+    double sinc = ce_sin(CE_PI * x) / (CE_PI * x);
+    return 0.5 * sinc / (1.0 - x * x);
+}
+
+// Zero-phase Hann window spectrum, sampled on [0, KERNEL_HALF_WIDTH] bins (it is symmetric)
+static constexpr std::array<float, KERNEL_LEN> make_window_kernel() {
+    std::array<float, KERNEL_LEN> t{};
+    for (int i = 0; i < KERNEL_LEN; i++) {
+        t[i] = (float)hann_kernel((double)i / KERNEL_OVERSAMPLE);
+    }
+    return t;
+}
+
+// Rising window half in Q15 (first half of the same Hann window), used to crossfade the oscillator bank
+static constexpr std::array<int16_t, IFFT_HOP> make_fade_in() {
+    std::array<int16_t, IFFT_HOP> t{};
+    for (int i = 0; i < IFFT_HOP; i++) {
+        t[i] = (int16_t)((0.5 - 0.5 * ce_cos(CE_PI * i / IFFT_HOP)) * 32767.0);
+    }
+    return t;
+}
+
+// kiss_fftri plan twiddles, inverse: exp(+2 pi i k / IFFT_CPX) and
+// exp(+pi i ((k + 1) / IFFT_CPX + 0.5)). Only copied into the plan at init,
+// so they stay in flash.
+static constexpr std::array<kiss_fft_cpx, IFFT_CPX> make_ifft_twiddles() {
+    std::array<kiss_fft_cpx, IFFT_CPX> t{};
+    for (int k = 0; k < IFFT_CPX; k++) {
+        double phase = TWO_PI * k / IFFT_CPX;
+        t[k].r = (float)ce_cos(phase);
+        t[k].i = (float)ce_sin(phase);
+    }
+    return t;
+}
+
+static constexpr std::array<kiss_fft_cpx, IFFT_CPX / 2> make_ifft_super_twiddles() {
+    std::array<kiss_fft_cpx, IFFT_CPX / 2> t{};
+    for (int k = 0; k < IFFT_CPX / 2; k++) {
+        double phase = CE_PI * ((double)(k + 1) / IFFT_CPX + 0.5);
+        t[k].r = (float)ce_cos(phase);
+        t[k].i = (float)ce_sin(phase);
+    }
+    return t;
+}
+
+static constexpr std::array<float, KERNEL_LEN> RAM_TABLE("ifft_kernel") window_kernel = make_window_kernel();
+static constexpr std::array<int16_t, IFFT_HOP> RAM_TABLE("ifft_fade") fade_in_q15 = make_fade_in();
+static constexpr std::array<kiss_fft_cpx, IFFT_CPX> ifft_twiddles = make_ifft_twiddles();
+static constexpr std::array<kiss_fft_cpx, IFFT_CPX / 2> ifft_super_twiddles = make_ifft_super_twiddles();
+
+// --- Helper Functions ---
+
+// Linear interpolation between kernel points
+static inline float kernel_at(float offset) {
+    float pos = fabsf(offset) * KERNEL_OVERSAMPLE;
+    int idx = (int)pos;
+    if (idx >= KERNEL_LEN - 1) return 0.0f;
+    float frac = pos - (float)idx;
+    return window_kernel[idx] + frac * (window_kernel[idx + 1] - window_kernel[idx]);
+}
+
+// Adds one windowed sinusoid with positive-frequency coefficient (re, im) at a fractional bin
+static inline void add_sinusoid(float bin, float re, float im) {
+    int k_lo = (int)ceilf(bin - KERNEL_HALF_WIDTH);
+    int k_hi = (int)floorf(bin + KERNEL_HALF_WIDTH);
+    if (k_lo < 0) k_lo = 0;
+
+    for (int k = k_lo; k <= k_hi; k++) {
+        float w = kernel_at((float)k - bin);
+        spectrum[k].r += re * w;
+        spectrum[k].i += im * w;
+    }
+
+    // Low partials: the negative-frequency image leaks into the first bins
+    for (int k = 0; k < KERNEL_HALF_WIDTH - bin; k++) {
+        float w = kernel_at((float)k + bin);
+        spectrum[k].r += re * w;
+        spectrum[k].i -= im * w;
+    }
+}
+
+// --- Public Functions ---
+
+void ifft_synth_init() {
+    // 1. Alloc Inverse FFT (twiddles precomputed: no soft-float cos/sin at boot)
+    ifft_cfg = kiss_fftr_alloc_twiddles(IFFT_SIZE, 1, ifft_twiddles.data(), ifft_super_twiddles.data(), NULL, NULL);
+
+    // 2. Clear Buffers (window kernel and crossfade ramp are precomputed)
+    memset(tail, 0, sizeof(tail));
+    ifft_begin_frame();
+    memset(&timbre, 0, sizeof(timbre));
+    timbre.im[0] = -1.0f; // Sine until the first ifft_set_timbre()
+    timbre.count = 1;
+
+    printf("[IFFT] Init. Frame: %d, Hop: %d\n", IFFT_SIZE, IFFT_HOP);
+}
+
+void ifft_begin_frame() {
+    memset(spectrum, 0, sizeof(spectrum));
+}
+
+void __not_in_flash_func(ifft_set_timbre)(const TimbreHarmonics *current, const TimbreHarmonics *previous, float weight) {
+    if (!previous) {
+        timbre = *current;
+        return;
+    }
+    // The harmonics are linear in the table, so blending them blends the tables
+    for (int h = 0; h < TIMBRE_PARTIAL_HARMONICS; h++) {
+        timbre.re[h] = previous->re[h] + weight * (current->re[h] - previous->re[h]);
+        timbre.im[h] = previous->im[h] + weight * (current->im[h] - previous->im[h]);
+    }
+    timbre.count = (current->count > previous->count) ? current->count : previous->count;
+}
+
+void __not_in_flash_func(ifft_add_partial)(uint32_t center_phase, uint32_t inc, float amp) {
+    // Fractional bin position of the fundamental
+    float bin = (float)inc * INC_TO_BIN;
+    if (bin <= 0.0f) return;
+
+    // Harmonic h+1 of A*table(phase) has the positive-frequency coefficient
+    // (A/2) * c_h * e^(j*(h+1)*phase); for a sine (c_0 = -j) that is the
+    // oscillator bank's A*sin(phase). e^(j*(h+1)*phase) is stepped by rotation.
+    float phase = (float)center_phase * PHASE_TO_RAD;
+    float step_re = cosf(phase);
+    float step_im = sinf(phase);
+    float rot_re = step_re;
+    float rot_im = step_im;
+    float half_amp = 0.5f * amp;
+
+    for (int h = 0; h < timbre.count; h++) {
+        float h_bin = bin * (float)(h + 1);
+        if (h_bin >= NUM_BINS - 1 - KERNEL_HALF_WIDTH) break;
+
+        float re = half_amp * (timbre.re[h] * rot_re - timbre.im[h] * rot_im);
+        float im = half_amp * (timbre.re[h] * rot_im + timbre.im[h] * rot_re);
+        add_sinusoid(h_bin, re, im);
+
+        float next_re = rot_re * step_re - rot_im * step_im;
+        rot_im = rot_re * step_im + rot_im * step_re;
+        rot_re = next_re;
+    }
+}
+
+void __not_in_flash_func(ifft_synthesize_frame)(int32_t *mix_buffer) {
+    kiss_fftri(ifft_cfg, spectrum, frame);
+
+    // The frame is zero-phase: frame[0] is its center, frame[IFFT_SIZE-1] is one sample before.
+    // This block covers [-HOP, 0) of the new frame plus [0, HOP) of the previous one.
+    for (int i = 0; i < IFFT_HOP; i++) {
+        mix_buffer[i] += (int32_t)(frame[IFFT_HOP + i] + tail[i]);
+        tail[i] = frame[i];
+    }
+}
+
+void __not_in_flash_func(ifft_flush_tail)(int32_t *mix_buffer) {
+    for (int i = 0; i < IFFT_HOP; i++) {
+        mix_buffer[i] += (int32_t)tail[i];
+    }
+    memset(tail, 0, sizeof(tail));
+}
+
+void __not_in_flash_func(ifft_crossfade_osc)(int32_t *mix_buffer, bool fading_in) {
+    for (int i = 0; i < IFFT_HOP; i++) {
+        int32_t gain = fading_in ? fade_in_q15[i] : (32767 - fade_in_q15[i]);
+        mix_buffer[i] = (int32_t)(((int64_t)mix_buffer[i] * gain) >> 15);
+    }
+}
@@ -0,0 +1,77 @@
+/**
+ * File: ifft_synth.hpp
+ * Description: Spectral (inverse-FFT) resynthesis engine.
+ * Builds the output spectrum directly from the active partials and turns it
+ * into audio with kiss_fftri + overlap-add. Cost is O(N log N) per block,
+ * independent of how many partials are playing.
+ * Each partial is rendered with the synth table's timbre: its first
+ * TIMBRE_PARTIAL_HARMONICS harmonics (wavetables.hpp), from the same DDS phase
+ * as the oscillator bank, so an engine switch keeps every voice's phase.
+ *
+ * Limitation: harmonics above TIMBRE_PARTIAL_HARMONICS are not rendered, so a
+ * bright table (saw, square) sounds duller here than from the oscillator bank.
+ */
+
+#ifndef IFFT_SYNTH_H
+#define IFFT_SYNTH_H
+
+#include <stdint.h>
+#include "macros.hpp"
+#include "wavetables.hpp" // TimbreHarmonics
+
+// One frame spans two output blocks (Hann window, 50% overlap)
+constexpr int IFFT_HOP  = O_BUFFER_SIZE;
+constexpr int IFFT_SIZE = 2 * IFFT_HOP;
+
+/**
+ * @brief Allocates the inverse FFT and precomputes the window kernel.
+ * Must be called once at startup.
+ */
+void ifft_synth_init();
+
+/**
+ * @brief Clears the spectrum for a new frame.
+ */
+void ifft_begin_frame();
+
+/**
+ * @brief Sets the timbre of the partials added to this frame. Call once per
+ * frame, before ifft_add_partial(). During a table crossfade the harmonics
+ * are blended at the frame center.
+ * @param current  Harmonics of the active table
+ * @param previous Harmonics of the table being faded out (NULL if none)
+ * @param weight   Weight of current, 0.0 - 1.0
+ */
+void ifft_set_timbre(const TimbreHarmonics *current, const TimbreHarmonics *previous, float weight);
+
+/**
+ * @brief Adds one partial, A*table(phase), to the current frame spectrum:
+ * the harmonics set by ifft_set_timbre(), up to the frame's top bin.
+ * @param center_phase DDS phase at the frame center (= end of the current block)
+ * @param inc          DDS phase step per output sample
+ * @param amp          Peak amplitude in output sample units
+ */
+void ifft_add_partial(uint32_t center_phase, uint32_t inc, float amp);
+
+/**
+ * @brief Inverse-transforms the frame and overlap-adds one hop into the mix.
+ * The frame's second half is kept as the tail for the next block.
+ * @param mix_buffer Mix accumulator (IFFT_HOP samples)
+ */
+void ifft_synthesize_frame(int32_t *mix_buffer);
+
+/**
+ * @brief Adds the pending tail of the last frame (a smooth fade-out) and clears it.
+ * Used on the block where the oscillator bank takes over again.
+ */
+void ifft_flush_tail(int32_t *mix_buffer);
+
+/**
+ * @brief Applies the complementary window half to an oscillator-bank block,
+ * so the engine switch is an equal-gain crossfade.
+ * @param mix_buffer Oscillator mix (IFFT_HOP samples), scaled in place
+ * @param fading_in  true when the oscillator bank takes over, false when it hands off
+ */
+void ifft_crossfade_osc(int32_t *mix_buffer, bool fading_in);
+
+#endif // IFFT_SYNTH_H
@@ -5,23 +5,27 @@
 // --- Global Instance Definitions ---
 FreqData frq_array[FFT_SIZE / 2];
 
-// Double Buffers in RAM
-int16_t input_buffer_1[HOP_SIZE];
-int16_t input_buffer_2[HOP_SIZE];
-
-// Pointers for Double Buffering
-int16_t* active_adc_dma_buffer = input_buffer_2;
-int16_t* inactive_adc_dma_buffer = input_buffer_1;
+// Capture Ring in RAM
+int16_t input_blocks[I_NUM_BLOCKS][HOP_SIZE] __attribute__((aligned(I_BLOCK_BYTES)));
 
 // Hardware Handles
-int adc_dma_chan;
-volatile bool new_data_ready = false;
+int adc_dma_chan[I_NUM_BLOCKS];
+volatile uint32_t input_block_count = 0;
+volatile uint32_t input_block_us[I_NUM_BLOCKS];
+
+// Consumer Side (Analysis)
+static uint32_t next_seq = 0;       // Oldest block not yet taken
+static InputStats input_stats;
 
 // --- Helper Functions ---
 
 static void init_input_buffers(void) {
-    memset(input_buffer_1, 0, sizeof(input_buffer_1));
-    memset(input_buffer_2, 0, sizeof(input_buffer_2));
+    memset(input_blocks, 0, sizeof(input_blocks));
+}
+
+// log2 of the block size in bytes, for the DMA write ring
+static constexpr uint ring_bits(uint bytes) {
+    return (bytes <= 1) ? 0 : 1 + ring_bits(bytes >> 1);
 }
 
 // --- Driver Implementation ---
@@ -55,50 +59,110 @@ void adc_setup() {
 }
 
 void dma_init_setup() {
-    // Claim Channel
-    adc_dma_chan = dma_claim_unused_channel(true);
-    
-    // Config
-    dma_channel_config c = dma_channel_get_default_config(adc_dma_chan);
-    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
-    channel_config_set_read_increment(&c, false); // Read from fixed FIFO
-    channel_config_set_write_increment(&c, true); // Write to buffer
-    channel_config_set_dreq(&c, DREQ_ADC);        // Paced by ADC
-    
-    // Apply Config
-    dma_channel_configure(
-        adc_dma_chan,
-        &c,
-        active_adc_dma_buffer, // Dest
-        &adc_hw->fifo,         // Source
-        HOP_SIZE,              // Count
-        false                  // Don't start yet
-    );
+    // Claim Channels
+    for (int b = 0; b < I_NUM_BLOCKS; b++) {
+        adc_dma_chan[b] = dma_claim_unused_channel(true);
+    }
+
+    for (int b = 0; b < I_NUM_BLOCKS; b++) {
+        // Config
+        dma_channel_config c = dma_channel_get_default_config(adc_dma_chan[b]);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+        channel_config_set_read_increment(&c, false);            // Read from fixed FIFO
+        channel_config_set_write_increment(&c, true);            // Write to block
+        channel_config_set_ring(&c, true, ring_bits(I_BLOCK_BYTES)); // Wrap back to the block start
+        channel_config_set_dreq(&c, DREQ_ADC);                   // Paced by ADC
+        channel_config_set_chain_to(&c, adc_dma_chan[(b + 1) % I_NUM_BLOCKS]); // Next block starts in hardware
+
+        // Apply Config
+        dma_channel_configure(
+            adc_dma_chan[b],
+            &c,
+            input_blocks[b],  // Dest
+            &adc_hw->fifo,    // Source
+            HOP_SIZE,         // Count (reloaded on every chain trigger)
+            false             // Don't start yet
+        );
+
+        // Setup Interrupts
+        dma_channel_set_irq1_enabled(adc_dma_chan[b], true);
+    }
 
-    // Setup Interrupts
-    dma_channel_set_irq1_enabled(adc_dma_chan, true);
     irq_set_exclusive_handler(DMA_IRQ_1, dma_isr);
     irq_set_enabled(DMA_IRQ_1, true);
 }
 
-// --- Critical Interrupt Service Routine ---
-// Executed when DMA finishes filling a buffer (HOP_SIZE samples)
-void dma_isr() {
-    // 1. Clear Interrupt Flag
-    dma_hw->ints1 = 1u << adc_dma_chan;
-
-    // 2. Swap Buffers (Ping-Pong)
-    // The 'active' buffer is now full, so it becomes 'inactive' (for analysis)
-    // The 'inactive' buffer is empty, so it becomes 'active' (for DMA)
-    int16_t* filled_buffer = active_adc_dma_buffer;
-    active_adc_dma_buffer = inactive_adc_dma_buffer;
-    inactive_adc_dma_buffer = filled_buffer;
-
-    // 3. Restart DMA immediately
-    // Point to the new empty buffer and reset counter
-    dma_channel_set_write_addr(adc_dma_chan, active_adc_dma_buffer, false);
-    dma_channel_set_trans_count(adc_dma_chan, HOP_SIZE, true); // Trigger now
-
-    // 4. Notify Main Loop
-    new_data_ready = true;
-}
\ No newline at end of file
+void input_capture_start() {
+    dma_channel_start(adc_dma_chan[0]);
+}
+
+// --- Interrupt Service Routine ---
+// Executed when a channel has filled its block (HOP_SIZE samples). The next
+// block is already being captured, so this only publishes the finished one.
+void __not_in_flash_func(dma_isr)() {
+    uint32_t now = time_us_32();
+
+    // Blocks complete in ring order, starting after the last one published
+    for (int i = 0; i < I_NUM_BLOCKS; i++) {
+        int b = (int)(input_block_count % I_NUM_BLOCKS);
+        uint32_t mask = 1u << adc_dma_chan[b];
+        if (!(dma_hw->ints1 & mask)) break;
+
+        // 1. Clear Interrupt Flag
+        dma_hw->ints1 = mask;
+
+        // 2. Publish (timestamp: the last sample was converted just before this)
+        input_block_us[b] = now;
+        input_block_count = input_block_count + 1;
+    }
+}
+
+// --- Input Queue (Analysis Side) ---
+
+uint32_t input_blocks_pending() {
+    return input_block_count - next_seq;
+}
+
+bool input_next_block(InputBlock *block, bool skip_to_newest) {
+    uint32_t count = input_block_count;
+    uint32_t pending = count - next_seq;
+    if (pending == 0) return false;
+
+    // 1. Overrun: the capture came round to the oldest unread blocks
+    if (pending > I_NUM_BLOCKS - 1) {
+        uint32_t lost = pending - (I_NUM_BLOCKS - 1);
+        input_stats.dropped += lost;
+        next_seq += lost;
+        pending -= lost;
+    }
+
+    // 2. Skip to the newest block on request
+    if (skip_to_newest && pending > 1) {
+        input_stats.skipped += pending - 1;
+        next_seq += pending - 1;
+        pending = 1;
+    }
+
+    // 3. Hand over the oldest remaining block
+    if (pending > 1) input_stats.late++;
+    int b = (int)(next_seq % I_NUM_BLOCKS);
+    block->samples = input_blocks[b];
+    block->seq = next_seq;
+    block->capture_us = input_block_us[b];
+    next_seq++;
+    input_stats.blocks++;
+    return true;
+}
+
+bool input_release_block(const InputBlock *block) {
+    // Block seq is overwritten once block seq + I_NUM_BLOCKS - 1 has completed
+    if (input_block_count - block->seq >= I_NUM_BLOCKS) {
+        input_stats.dropped++;
+        return false;
+    }
+    return true;
+}
+
+const InputStats* get_input_stats() {
+    return &input_stats;
+}
@@ -27,39 +27,110 @@ typedef enum {
     RELEASE = -1
 } Env_Phase;
 
-// Shared State for Synthesis & Analysis
+// Per-Voice Synthesis State (owned by the synthesis core)
+// The analysis never writes here: its results arrive as ControlFrames
+// (control_queue.hpp) and are copied in at a block boundary.
 typedef struct FreqData{
-    // Synthesis Fields (Read by Output, Written by Analysis)
+    // Control Fields (Copied from the newest ControlFrame)
     bool play;                  // Gate flag
+    int16_t amp;                // Target Amplitude (Q15)
+    int env_phase;              // Env_Phase of the analysed amplitude
+
+    // Oscillator Fields
     uint32_t accumalated_phase; // DDS Phase Accumulator
     uint32_t increment_j;       // DDS Phase Step
-    int16_t amp;                // Target Amplitude (Q15)
-    float current_amp;          // Smoothed Amplitude (for envelope)
 
-    // Analysis Fields (Read/Written by Analysis)
-    float amp_float;            // History for jitter filter
-    bool is_peak;               // Debug/Vis flag
-    int env_phase;              // Envelope state
-    int stability;              // Debounce counter
+    // Envelope Fields (Owned by Output, see envelope.hpp)
+    int16_t current_amp;        // Envelope Level (Q15), at the end of the last block
+    int16_t env_start;          // Level the current segment started from
+    uint32_t env_pos;           // Segment progress (Q32)
+    uint8_t env_stage;          // Env_Stage
+    int8_t env_last_phase;      // env_phase seen last block (re-pluck edge detect)
+    bool stolen;                // Fast-released by the polyphony limit (until the note ends or re-plucks)
+
+    // Phase Measurement (Control Fields, read by phase alignment)
+    float string_freq_hz;       // Refined peak frequency
+    uint32_t string_phase;      // String phase (DDS units, sine convention) at string_phase_us
+    uint32_t string_phase_us;   // Time the string had that phase
+    bool phase_valid;           // Measurement belongs to the current peak
 } FreqData;
 
 // Global Accessors
 extern FreqData frq_array[FFT_SIZE / 2];
 
-// DMA Double Buffers
-extern int16_t input_buffer_1[HOP_SIZE];
-extern int16_t input_buffer_2[HOP_SIZE];
+// --- Capture Ring ---
+// One DMA channel per HOP_SIZE block, chained in a cycle: when one finishes,
+// the next is already running, so the capture never waits on the CPU. Each
+// channel's write address wraps on its own block (DMA write ring), so it is
+// back at the block start for its next turn without being reprogrammed.
+// Blocks complete in ring order and are numbered from 0 (sequence number);
+// block seq lives in input_blocks[seq % I_NUM_BLOCKS]. One block is always
+// being captured, so up to I_NUM_BLOCKS - 1 can wait for the analysis.
+constexpr int I_NUM_BLOCKS = 4;
+static_assert(I_NUM_BLOCKS >= 2 && I_NUM_BLOCKS <= 8, "Input queue depth: 2..8 blocks (one DMA channel each)");
+constexpr uint I_BLOCK_BYTES = HOP_SIZE * sizeof(int16_t);
+static_assert((I_BLOCK_BYTES & (I_BLOCK_BYTES - 1)) == 0, "DMA write ring needs a power-of-two block");
+
+// Blocks, each aligned to its own size (required by the write ring)
+extern int16_t input_blocks[I_NUM_BLOCKS][HOP_SIZE];
+
+// DMA channel per block
+extern int adc_dma_chan[I_NUM_BLOCKS];
 
-// Buffer Pointers (Swapped in ISR)
-extern int16_t* active_adc_dma_buffer;
-extern int16_t* inactive_adc_dma_buffer;
+// Published by the ISR (the only thing it does)
+extern volatile uint32_t input_block_count;             // Blocks completed since the capture started
+extern volatile uint32_t input_block_us[I_NUM_BLOCKS];  // Capture time of each block's last sample
 
-extern int adc_dma_chan;
-extern volatile bool new_data_ready;
+// A completed block handed to the analysis
+typedef struct InputBlock {
+    const int16_t *samples;     // HOP_SIZE samples
+    uint32_t seq;               // Sequence number (blocks since the capture started)
+    uint32_t capture_us;        // Capture time of the last sample
+} InputBlock;
+
+// --- Input Telemetry ---
+typedef struct InputStats {
+    uint32_t blocks;            // Blocks handed to the analysis
+    uint32_t dropped;           // Overwritten by the capture before (or while) being read
+    uint32_t late;              // Handed over while a newer block was already waiting
+    uint32_t skipped;           // Passed over on purpose (skip to newest)
+} InputStats;
 
 // --- Function Prototypes ---
 void adc_setup();
 void dma_init_setup();
 void dma_isr();
 
+/**
+ * @brief Starts the capture ring (first block's channel). Arm before adc_run().
+ */
+void input_capture_start();
+
+/**
+ * @brief Completed blocks the analysis has not taken yet. More than
+ * I_NUM_BLOCKS - 1 means some were overwritten (counted at the next take).
+ */
+uint32_t input_blocks_pending();
+
+/**
+ * @brief Takes the oldest unread block, so the analysis catches up in order.
+ * Blocks the capture has already come round to are counted as dropped.
+ * @param block          Filled on success
+ * @param skip_to_newest Pass over every waiting block except the newest
+ * @return false if no completed block is waiting
+ */
+bool input_next_block(InputBlock *block, bool skip_to_newest);
+
+/**
+ * @brief Ends the use of a block. If the capture overwrote it in the
+ * meantime, it is counted as dropped.
+ * @return true if the block was intact the whole time
+ */
+bool input_release_block(const InputBlock *block);
+
+/**
+ * @brief Returns the input queue counters.
+ */
+const InputStats* get_input_stats();
+
 #endif // INPUT_H
\ No newline at end of file
@@ -18,6 +18,14 @@
 #include "kiss_fft_log.h"
 #include <limits.h>
 
+/* Placement of the transform loops. Builds for an MCU with slow code memory
+   can define KISS_FFT_RAM_CODE to put them in a RAM-resident section. */
+#if defined(KISS_FFT_RAM_CODE) && KISS_FFT_RAM_CODE
+#define KISS_FFT_HOT __attribute__((section(".time_critical.kissfft")))
+#else
+#define KISS_FFT_HOT
+#endif
+
 #define MAXFACTORS 32
 /* e.g. an fft of length 128 has 4 factors
  as far as kissfft is concerned
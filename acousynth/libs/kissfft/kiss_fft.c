@@ -12,7 +12,7 @@
  fixed or floating point complex numbers.  It also delares the kf_ internal functions.
  */
 
-static void kf_bfly2(
+static void KISS_FFT_HOT kf_bfly2(
         kiss_fft_cpx * Fout,
         const size_t fstride,
         const kiss_fft_cfg st,
@@ -35,7 +35,7 @@ static void kf_bfly2(
     }while (--m);
 }
 
-static void kf_bfly4(
+static void KISS_FFT_HOT kf_bfly4(
         kiss_fft_cpx * Fout,
         const size_t fstride,
         const kiss_fft_cfg st,
@@ -83,7 +83,7 @@ static void kf_bfly4(
     }while(--k);
 }
 
-static void kf_bfly3(
+static void KISS_FFT_HOT kf_bfly3(
          kiss_fft_cpx * Fout,
          const size_t fstride,
          const kiss_fft_cfg st,
@@ -127,7 +127,7 @@ static void kf_bfly3(
      }while(--k);
 }
 
-static void kf_bfly5(
+static void KISS_FFT_HOT kf_bfly5(
         kiss_fft_cpx * Fout,
         const size_t fstride,
         const kiss_fft_cfg st,
@@ -189,7 +189,7 @@ static void kf_bfly5(
 }
 
 /* perform the butterfly for one stage of a mixed radix FFT */
-static void kf_bfly_generic(
+static void KISS_FFT_HOT kf_bfly_generic(
         kiss_fft_cpx * Fout,
         const size_t fstride,
         const kiss_fft_cfg st,
@@ -233,7 +233,7 @@ static void kf_bfly_generic(
 }
 
 static
-void kf_work(
+void KISS_FFT_HOT kf_work(
         kiss_fft_cpx * Fout,
         const kiss_fft_cpx * f,
         const size_t fstride,
@@ -334,7 +334,7 @@ void kf_factor(int n,int * facbuf)
  * The return value is a contiguous block of memory, allocated with malloc.  As such,
  * It can be freed with free(), rather than a kiss_fft-specific function.
  * */
-kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem )
+static kiss_fft_cfg kf_alloc(int nfft,int inverse_fft,const kiss_fft_cpx * twiddles,void * mem,size_t * lenmem )
 {
     KISS_FFT_ALIGN_CHECK(mem)
 
@@ -354,12 +354,16 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem
         st->nfft=nfft;
         st->inverse = inverse_fft;
 
-        for (i=0;i<nfft;++i) {
-            const double pi=3.141592653589793238462643383279502884197169399375105820974944;
-            double phase = -2*pi*i / nfft;
-            if (st->inverse)
-                phase *= -1;
-            kf_cexp(st->twiddles+i, phase );
+        if (twiddles) {
+            memcpy(st->twiddles, twiddles, sizeof(kiss_fft_cpx)*nfft);
+        } else {
+            for (i=0;i<nfft;++i) {
+                const double pi=3.141592653589793238462643383279502884197169399375105820974944;
+                double phase = -2*pi*i / nfft;
+                if (st->inverse)
+                    phase *= -1;
+                kf_cexp(st->twiddles+i, phase );
+            }
         }
 
         kf_factor(nfft,st->factors);
@@ -367,8 +371,18 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem
     return st;
 }
 
+kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem )
+{
+    return kf_alloc(nfft, inverse_fft, NULL, mem, lenmem);
+}
+
+kiss_fft_cfg kiss_fft_alloc_twiddles(int nfft,int inverse_fft,const kiss_fft_cpx * twiddles,void * mem,size_t * lenmem )
+{
+    return kf_alloc(nfft, inverse_fft, twiddles, mem, lenmem);
+}
+
 
-void kiss_fft_stride(kiss_fft_cfg st,const kiss_fft_cpx *fin,kiss_fft_cpx *fout,int in_stride)
+void KISS_FFT_HOT kiss_fft_stride(kiss_fft_cfg st,const kiss_fft_cpx *fin,kiss_fft_cpx *fout,int in_stride)
 {
     if (fin == fout) {
         //NOTE: this is not really an in-place FFT algorithm.
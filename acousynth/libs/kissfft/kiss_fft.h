@@ -116,6 +116,16 @@ typedef struct kiss_fft_state* kiss_fft_cfg;
 
 kiss_fft_cfg KISS_FFT_API kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem);
 
+/*
+ * kiss_fft_alloc_twiddles
+ *
+ * Same as kiss_fft_alloc, but copies the nfft twiddle factors
+ * exp(-/+ 2*pi*i*k/nfft) (minus for forward, plus for inverse) from
+ * 'twiddles' instead of computing them with cos/sin. For targets without
+ * an FPU, where the table can be computed at compile time.
+ * */
+kiss_fft_cfg KISS_FFT_API kiss_fft_alloc_twiddles(int nfft,int inverse_fft,const kiss_fft_cpx * twiddles,void * mem,size_t * lenmem);
+
 /*
  * kiss_fft(cfg,in_out_buf)
  *
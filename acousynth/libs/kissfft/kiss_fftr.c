@@ -18,7 +18,8 @@ struct kiss_fftr_state{
 #endif
 };
 
-kiss_fftr_cfg kiss_fftr_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem)
+static kiss_fftr_cfg kf_fftr_alloc(int nfft,int inverse_fft,const kiss_fft_cpx * twiddles,
+                                   const kiss_fft_cpx * super_twiddles,void * mem,size_t * lenmem)
 {
 	KISS_FFT_ALIGN_CHECK(mem)
 
@@ -32,7 +33,7 @@ kiss_fftr_cfg kiss_fftr_alloc(int nfft,int inverse_fft,void * mem,size_t * lenme
     }
     nfft >>= 1;
 
-    kiss_fft_alloc (nfft, inverse_fft, NULL, &subsize);
+    kiss_fft_alloc_twiddles (nfft, inverse_fft, twiddles, NULL, &subsize);
     memneeded = sizeof(struct kiss_fftr_state) + subsize + sizeof(kiss_fft_cpx) * ( nfft * 3 / 2);
 
     if (lenmem == NULL) {
@@ -48,19 +49,34 @@ kiss_fftr_cfg kiss_fftr_alloc(int nfft,int inverse_fft,void * mem,size_t * lenme
     st->substate = (kiss_fft_cfg) (st + 1); /*just beyond kiss_fftr_state struct */
     st->tmpbuf = (kiss_fft_cpx *) (((char *) st->substate) + subsize);
     st->super_twiddles = st->tmpbuf + nfft;
-    kiss_fft_alloc(nfft, inverse_fft, st->substate, &subsize);
-
-    for (i = 0; i < nfft/2; ++i) {
-        double phase =
-            -3.14159265358979323846264338327 * ((double) (i+1) / nfft + .5);
-        if (inverse_fft)
-            phase *= -1;
-        kf_cexp (st->super_twiddles+i,phase);
+    kiss_fft_alloc_twiddles(nfft, inverse_fft, twiddles, st->substate, &subsize);
+
+    if (super_twiddles) {
+        memcpy(st->super_twiddles, super_twiddles, sizeof(kiss_fft_cpx) * (nfft/2));
+    } else {
+        for (i = 0; i < nfft/2; ++i) {
+            double phase =
+                -3.14159265358979323846264338327 * ((double) (i+1) / nfft + .5);
+            if (inverse_fft)
+                phase *= -1;
+            kf_cexp (st->super_twiddles+i,phase);
+        }
     }
     return st;
 }
 
-void kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata)
+kiss_fftr_cfg kiss_fftr_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem)
+{
+    return kf_fftr_alloc(nfft, inverse_fft, NULL, NULL, mem, lenmem);
+}
+
+kiss_fftr_cfg kiss_fftr_alloc_twiddles(int nfft,int inverse_fft,const kiss_fft_cpx * twiddles,
+                                       const kiss_fft_cpx * super_twiddles,void * mem,size_t * lenmem)
+{
+    return kf_fftr_alloc(nfft, inverse_fft, twiddles, super_twiddles, mem, lenmem);
+}
+
+void KISS_FFT_HOT kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata)
 {
     /* input buffer timedata is stored row-wise */
     int k,ncfft;
@@ -116,7 +132,7 @@ void kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *fr
     }
 }
 
-void kiss_fftri(kiss_fftr_cfg st,const kiss_fft_cpx *freqdata,kiss_fft_scalar *timedata)
+void KISS_FFT_HOT kiss_fftri(kiss_fftr_cfg st,const kiss_fft_cpx *freqdata,kiss_fft_scalar *timedata)
 {
     /* input buffer timedata is stored row-wise */
     int k, ncfft;
@@ -33,6 +33,16 @@ kiss_fftr_cfg KISS_FFT_API kiss_fftr_alloc(int nfft,int inverse_fft,void * mem,
  If you don't care to allocate space, use mem = lenmem = NULL 
 */
 
+kiss_fftr_cfg KISS_FFT_API kiss_fftr_alloc_twiddles(int nfft,int inverse_fft,const kiss_fft_cpx * twiddles,
+                                                    const kiss_fft_cpx * super_twiddles,void * mem, size_t * lenmem);
+/*
+ Same as kiss_fftr_alloc, with every twiddle factor precomputed instead of
+ computed with cos/sin (see kiss_fft_alloc_twiddles). With m = nfft/2:
+   twiddles:       m entries,   exp(-/+ 2*pi*i*k/m)
+   super_twiddles: m/2 entries, exp(-/+ pi*i*((k+1)/m + 0.5))
+ (minus for forward, plus for inverse)
+*/
+
 
 void KISS_FFT_API kiss_fftr(kiss_fftr_cfg cfg,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata);
 /*
@@ -4,23 +4,60 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <cstdint>
+#include "pico/platform.h" // __not_in_flash, __scratch_x/y
 
-#define FS_O 44100
+// Output sample rate, fixed at build time (CMake cache: ACOUSYNTH_FS_O).
+// Every rate-dependent constant (DDS increments, envelope rates, I2S clock,
+// block timing) derives from FS_O. The exciter gains nothing above ~10 kHz,
+// and synthesis cost scales with FS_O, so lower rates free CPU.
+#ifndef ACOUSYNTH_FS_O
+#define ACOUSYNTH_FS_O 44100
+#endif
+#define FS_O ACOUSYNTH_FS_O
+static_assert(FS_O == 22050 || FS_O == 32000 || FS_O == 44100 || FS_O == 48000,
+              "FS_O must be 22050, 32000, 44100 or 48000");
 #define O_BUFFER_SIZE 256
 
 #define WAVETABLE_BITS 10 //log(TABLE_SIZE=O_BUFFERSIZE)
 const int PHASE_SHIFT = 32 - WAVETABLE_BITS;
 #define WAVETABLE_LEN 1024
 #define WAVETABLE_MASK (WAVETABLE_LEN - 1)
+// Band-limited copies of the synth table, one per octave of phase increment.
+// Level L holds (WAVETABLE_LEN/2 >> L) harmonics; 6 levels cover every
+// partial the analysis can report (FS_I/2 ~ 627 Hz) with room to spare.
+#define WAVETABLE_MIP_LEVELS 6
 
 #define TWO_PI 6.28318530718
 #define two32 4294967296.0
 
+// Direct Digital Synthesis (DDS) Constant: 2^32 / Fs_out
+// Maps a target Hz value to a 32-bit phase step per sample.
+constexpr double DDS_FACTOR = two32 / (double)FS_O;
+
 #define FS_I 1255
 #define HOP_SIZE 128
 #define FFT_SIZE 512
 #define I_BUFFER_SIZE FFT_SIZE
 #define NUM_FREQS (FFT_SIZE / 2)
 
+// --- Memory Placement (RP2040) ---
+// Code in flash runs through the 16 KB XIP cache, and a miss stalls the core
+// for a flash read. Code and tables touched every audio block are therefore
+// placed in SRAM: functions with __not_in_flash_func(), read-only tables
+// with RAM_TABLE() (copied from flash at boot). Large buffers (wavetables,
+// render lists) stay in the striped main SRAM (banks 0-3, word-interleaved,
+// so both cores and the DMA rarely hit the same bank). SCRATCH_X and
+// SCRATCH_Y are 4 KB banks with their own bus port that also hold the
+// stacks (core1 in X, core0 in Y); the per-block mix buffers of each core
+// go next to that core's stack. Which core renders audio is fixed at build
+// time (DUAL_CORE, set in CMake). Check with the memmap_report build target.
+#define RAM_TABLE(name)           __not_in_flash(name)
+#ifdef DUAL_CORE
+#define AUDIO_CORE_SCRATCH(name)  __scratch_x(name)   // Audio renders on core1
+#define HELPER_CORE_SCRATCH(name) __scratch_y(name)   // Render helper on core0
+#else
+#define AUDIO_CORE_SCRATCH(name)  __scratch_y(name)   // Audio renders on core0
+#define HELPER_CORE_SCRATCH(name) __scratch_x(name)   // Render helper on core1
+#endif
 
 #endif /* MACROS_H */
\ No newline at end of file
@@ -12,32 +12,377 @@
 #include "output_config.hpp"
 #include "analysis.hpp"
 #include "wavetables.hpp"
+#include "envelope.hpp"
+#include "output_stage.hpp"
+#include "ifft_synth.hpp"
+#include "benchmarks.hpp"
+#include "control_queue.hpp"
+#include "usb_capture.hpp"
+#include "scheduler.hpp"
+#include "clock_governor.hpp"
 #include "pico/audio_i2s.h"
+#include "pico/multicore.h"
+#include "pico/stdio_usb.h"
 #include "hardware/irq.h"
 #include <stdio.h> 
 
+// --- Benchmark Toggle ---
+// Uncomment to print kernel benchmarks at boot (before audio starts)
+//#define RUN_BENCHMARKS
+
+// --- Timbre Capture Toggle ---
+// Uncomment to synthesize the table from the guitar's own harmonic profile
+// (one voice per note) instead of the fixed Sine/Saw/Square/Triangle mix
+//#define TIMBRE_CAPTURE
+
+// --- Output Limiter Toggle ---
+// Comment out to leave only the soft clipper on the output
+#define OUTPUT_LIMITER
+
+// --- Phase Alignment Toggle ---
+// Uncomment to lock each voice's phase to the measured string phase
+// (calibrate DEFAULT_LOOP_LATENCY_US in output_config.hpp first)
+//#define PHASE_ALIGN
+
+// --- Dual-Core Toggle ---
+// Synthesis on core1, analysis on core0 (results handed over through
+// control_queue.hpp). Set in CMake (ACOUSYNTH_DUAL_CORE, default ON) rather
+// than here, because the per-core memory placement in macros.hpp depends on
+// it: -DACOUSYNTH_DUAL_CORE=OFF runs everything in one core0 loop.
+
+// --- Refill Mode Toggle ---
+// Uncomment to refill the audio buffers from an interrupt pended by the I2S
+// DMA (pull model) instead of polling fetch_o_samples() in a loop
+//#define IRQ_REFILL
+
+// --- Adaptive Buffering Toggle ---
+// Uncomment to let the output tune its pool depth and block length
+// (shorter latency when there is headroom, more buffering after underruns)
+//#define ADAPTIVE_BUFFERING
+
+// --- Parallel Render Toggle ---
+// Uncomment to split the oscillator voices between both cores for large
+// chords (the core not rendering audio helps from its FIFO interrupt)
+//#define PARALLEL_RENDER
+
+// --- USB Capture Toggle ---
+// Uncomment to stream every analysed input block over USB as binary frames
+// (record to WAV on the host with tools/acap_to_wav.py)
+//#define USB_CAPTURE
+
+// --- Clock Governor Toggle ---
+// Uncomment to step clk_sys between 62.5, 125 and 250 MHz with the DSP load
+// (output sample rate and ADC rate are unaffected, see clock_governor.hpp)
+//#define CLOCK_GOVERNOR
+
+// --- Fast Boot Toggle ---
+// Uncomment to start audio without waiting for a serial terminal: USB comes
+// up in the background (the boot log before the host connects is dropped,
+// the boot timing report is printed once it does) and the startup timbre is
+// built in the background, faded in over a sine within the first blocks
+//#define FAST_BOOT
+
+// --- Telemetry Toggle ---
+// Uncomment to print render time, worst-case output headroom and underruns
+//#define PRINT_TELEMETRY
+
 // --- Configuration Constants ---
 constexpr uint STATUS_LED_PIN = 15;
-constexpr uint STARTUP_DELAY_MS = 2000;
+constexpr uint STARTUP_DELAY_MS = 2000;     // Time for a terminal to attach (not with FAST_BOOT)
+constexpr int  BOOT_MAX_STAGES = 10;
 constexpr int  NUM_PRIME_BUFFERS = 2;
+constexpr uint32_t TELEMETRY_INTERVAL_MS = 2000;
+constexpr uint32_t INPUT_CATCHUP_BLOCKS = 2;  // Analysis backlog beyond which it skips to the newest block
+constexpr uint32_t LED_BLINK_MS = 500;
+
+// --- Task Deadlines (scheduler.hpp) ---
+// How long each task may wait once it has work. Audio refill goes first;
+// an analysis hop must be done before the next one arrives.
+constexpr uint32_t AUDIO_DEADLINE_US    = 0;
+constexpr uint32_t ANALYSIS_DEADLINE_US = (uint32_t)(HOP_SIZE * 1000000ULL / FS_I);
+constexpr uint32_t TIMBRE_DEADLINE_US   = ANALYSIS_DEADLINE_US;
+
+// --- Envelope Parameters ---
+// ADSR applied on top of the analysed amplitude (adjustable at runtime via set_synth_env)
+constexpr uint16_t ATTACK_MS   = ENV_DEFAULT_ATTACK_MS;
+constexpr uint16_t DECAY_MS    = ENV_DEFAULT_DECAY_MS;
+constexpr int16_t  SUSTAIN_Q15 = ENV_DEFAULT_SUSTAIN;  // Q15, 32767 = follow the guitar
+constexpr uint16_t RELEASE_MS  = ENV_DEFAULT_RELEASE_MS;
+
+// --- Audio Output Bring-Up ---
+// Runs on the core that renders audio: the I2S DMA interrupt is enabled on
+// the calling core.
+static void start_audio_output() {
+    // Configure I2S Output (PIO based)
+    set_i2s();
+    connect_o_buffers();
+#ifdef CLOCK_GOVERNOR
+    governor_start_i2s();
+#endif
+    printf("[System] Audio Output Configured\n");
+
+    // Buffer Priming (Crucial for I2S Stability)
+    // We manually fill the buffer pool BEFORE starting the hardware.
+    // This prevents the I2S engine from reading empty memory (underflow) at startup.
+    printf("[System] Priming Audio Buffers...\n");
+    for (int i = 0; i < NUM_PRIME_BUFFERS; i++) {
+        fetch_o_samples();
+    }
+    start_o_stream();
+
+#ifdef IRQ_REFILL
+    start_o_refill_irq();
+#else
+    start_o_refill_events();
+#endif
+}
+
+#ifdef DUAL_CORE
+// --- Core 1: Synthesis ---
+static void core1_main() {
+    start_audio_output();
+    printf("[System] Synthesis Running on Core 1\n");
+
+    while (true) {
+#ifdef IRQ_REFILL
+        __wfi(); // Refill runs in the interrupt
+#else
+        // Refill until every buffer is queued, then sleep until the I2S DMA
+        // interrupt (on this core) hands one back
+        if (!fetch_o_samples()) __wfe();
+#endif
+    }
+}
+#elif defined(PARALLEL_RENDER)
+// --- Core 1: Render Helper Only ---
+static void core1_main() {
+    start_render_helper();
+    while (true) {
+        __wfi(); // All work arrives through the SIO FIFO interrupt
+    }
+}
+#endif
+
+// --- Analysis Slice Scheduling ---
+// Runs the next analysis slice only if it ends before the output needs its
+// next refill, so a refill is delayed by one slice at most. A slice longer
+// than a whole block can never fit and runs as soon as the pool is full.
+static bool analysis_slice_fits() {
+#if !defined(DUAL_CORE) && !defined(IRQ_REFILL)
+    uint32_t cost_us = analysis_next_slice_us();
+    if (cost_us >= o_block_us(get_output_stats()->block_len)) return true;
+    return (int32_t)cost_us < get_output_refill_due_us();
+#else
+    return true; // Audio is refilled elsewhere: no deadline in this loop
+#endif
+}
+
+#ifdef PRINT_TELEMETRY
+static void print_telemetry() {
+    const OutputStats *s = get_output_stats();
+    printf("[Stats] Render %lu us (max %lu us), Headroom min %ld us, Underruns %lu, Voices %d (fits %lu), Dropped frames %lu\n",
+           (unsigned long)s->last_render_us, (unsigned long)s->max_render_us,
+           (long)s->min_headroom_us, (unsigned long)s->underruns, s->active_voices,
+           (unsigned long)s->voices_per_block, (unsigned long)control_frames_dropped());
+    printf("[Stats] Latency %lu us (%d x %u samples)\n",
+           (unsigned long)s->latency_us, s->pool_depth, s->block_len);
+
+    const InputStats *in = get_input_stats();
+    printf("[Stats] Input blocks %lu, Dropped %lu, Late %lu, Skipped %lu, Analysis slice max %lu us\n",
+           (unsigned long)in->blocks, (unsigned long)in->dropped,
+           (unsigned long)in->late, (unsigned long)in->skipped,
+           (unsigned long)analysis_max_slice_us());
+#ifdef CLOCK_GOVERNOR
+    const GovStats *gov = get_governor_stats();
+    printf("[Stats] Clock %lu MHz, Load %lu%%, Switches %lu\n",
+           (unsigned long)(gov->sys_hz / 1000000), (unsigned long)gov->load_pct,
+           (unsigned long)gov->switches);
+#endif
+#ifdef USB_CAPTURE
+    const CaptureStats *cap = get_capture_stats();
+    printf("[Stats] Capture frames %lu, Dropped %lu\n",
+           (unsigned long)cap->frames, (unsigned long)cap->dropped);
+#endif
+}
+#endif
 
-// --- Control Loop Parameters ---
-// Kp: Proportional gain for the amplitude envelope follower.
-// Tuned for: Kp = 1/(FS_O * tau)
-float Kp = 0.002f; 
+// --- Boot Timing ---
+// End time of each boot stage, on the microsecond timer (which starts just
+// after the clocks are set up at reset). Reported once a terminal is
+// connected and the audio is running, so a fast boot doesn't lose it.
+static const char *boot_stage_name[BOOT_MAX_STAGES];
+static uint32_t boot_stage_end_us[BOOT_MAX_STAGES];
+static int boot_stages = 0;
+static bool boot_reported = false;
+
+static void boot_stage(const char *name) {
+    if (boot_stages == BOOT_MAX_STAGES) return;
+    boot_stage_name[boot_stages] = name;
+    boot_stage_end_us[boot_stages] = time_us_32();
+    boot_stages++;
+}
+
+static void print_boot_report() {
+    printf("[Boot] Stage        End (us)  Took (us)\n");
+    uint32_t prev = 0;
+    for (int i = 0; i < boot_stages; i++) {
+        printf("[Boot]   %-10s %8lu   %8lu\n", boot_stage_name[i],
+               (unsigned long)boot_stage_end_us[i], (unsigned long)(boot_stage_end_us[i] - prev));
+        prev = boot_stage_end_us[i];
+    }
+    uint32_t first_audio = get_output_stats()->stream_start_us;
+    printf("[Boot] Audio running %lu.%lu ms after reset\n",
+           (unsigned long)(first_audio / 1000), (unsigned long)(first_audio % 1000 / 100));
+}
+
+// --- Main Loop Tasks ---
+// Run by the scheduler (scheduler.hpp) in deadline order; the core sleeps
+// in __wfe() whenever none of them has work.
+
+#if !defined(DUAL_CORE) && !defined(IRQ_REFILL)
+static bool output_full = false;    // The last refill found every buffer queued
+
+// A. Audio Synthesis
+// One block per run until every buffer is queued; then woken by the I2S DMA.
+static bool audio_ready() {
+    return o_refill_pending() || !output_full;
+}
+
+static void audio_task() {
+    output_full = !fetch_o_samples();
+}
+#else
+static const bool output_full = true; // Refill doesn't depend on this loop
+#endif
+
+// B. Spectral Analysis (Event Driven, Time-Sliced)
+// A new hop is taken once the previous frame is done: one queued input
+// block at a time, oldest first, so a slow hop is caught up in order; too
+// far behind, jump to the newest block. The frame then advances one slice
+// per run, between output refills.
+static bool analysis_ready() {
+    if (!analysis_busy()) return input_blocks_pending() > 0;
+    return output_full && analysis_slice_fits();
+}
+
+static void analysis_task() {
+    if (analysis_busy()) {
+        analysis_run_slice();
+        return;
+    }
+
+    InputBlock block;
+    if (input_next_block(&block, input_blocks_pending() > INPUT_CATCHUP_BLOCKS)) {
+        // Raw samples to the host first, while the block is freshest
+        usb_capture_block(&block);
+
+        // Copies the hop; the block can go back to the capture at once
+        analysis_start(block.samples, block.capture_us);
+        input_release_block(&block);
+    }
+}
+
+// C. Background Timbre Build
+// One slice per run, so a timbre change never stalls audio refill
+static void timbre_task() {
+    service_synth_table();
+}
+
+// D. Heartbeat LED
+static void led_task() {
+    gpio_put(STATUS_LED_PIN, !gpio_get(STATUS_LED_PIN));
+}
+
+#ifdef PRINT_TELEMETRY
+// E. Telemetry
+static void telemetry_task() {
+    print_telemetry();
+    print_sched_stats();
+}
+#endif
+
+// F. Boot Report
+// Once, as soon as there is a terminal to print to
+static bool boot_report_ready() {
+    return !boot_reported && stdio_usb_connected() && get_output_stats()->stream_start_us != 0;
+}
+
+static void boot_report_task() {
+    print_boot_report();
+    boot_reported = true;
+}
+
+#ifdef CLOCK_GOVERNOR
+// G. Clock Governor
+static void governor_task() {
+    static uint32_t last_idle_us = 0;
+    static uint32_t last_us = time_us_32();
+    uint32_t now = time_us_32();
+    uint32_t idle = sched_idle_us();
+    uint32_t window_us = now - last_us;
+    uint32_t idle_delta = idle - last_idle_us;
+    uint32_t busy_pct = (window_us > idle_delta) ? (uint32_t)((uint64_t)(window_us - idle_delta) * 100 / window_us) : 0;
+    last_idle_us = idle;
+    last_us = now;
+    governor_update(busy_pct);
+}
+#endif
 
 // --- Main Application ---
 int main() {
     // 1. System Initialization
-    stdio_init_all();
+    boot_stage("runtime");
+    stdio_init_all(); // USB enumerates in the background
+#if !defined(FAST_BOOT) || defined(RUN_BENCHMARKS)
+    // Wait for a terminal (benchmark results are printed before audio starts)
     sleep_ms(STARTUP_DELAY_MS);
+#endif
     printf("=== Acousynth Live System Starting ===\n");
+    boot_stage("stdio");
+
+#ifdef CLOCK_GOVERNOR
+    // Clock plan first: everything below (I2S divider included) sees the final clocks
+    governor_init(GOV_NOMINAL);
+    boot_stage("clocks");
+#endif
     
     // Initialize Subsystems
+    // Every lookup table is precomputed in flash; only the synth table is filled here
     init_wavetables();
-    set_synth_table(0.5, 0.5f, 0.0f, 0.0f);; // Weights for: Sine, Saw, Square, Triangle
+    set_synth_table(0.5, 0.5f, 0.0f, 0.0f); // Weights for: Sine, Saw, Square, Triangle
+#ifndef FAST_BOOT
+    flush_synth_table(); // Audio isn't running yet: build it now
+#endif
+    boot_stage("tables");
+    set_synth_env(ATTACK_MS, DECAY_MS, SUSTAIN_Q15, RELEASE_MS);
     increment_init();
+    control_queue_init();
+    ifft_synth_init();
     analysis_init();
+    boot_stage("synth");
+
+#ifdef RUN_BENCHMARKS
+    // Before audio starts: the benchmarks replace the synth table and reset the output stage
+    run_benchmarks();
+    set_synth_table(0.5, 0.5f, 0.0f, 0.0f); // Restore the live timbre
+    flush_synth_table();
+#endif
+
+#ifdef TIMBRE_CAPTURE
+    set_timbre_capture(true);
+#endif
+#ifdef OUTPUT_LIMITER
+    set_output_limiter(true);
+#endif
+#ifdef ADAPTIVE_BUFFERING
+    set_adaptive_buffering(true);
+#endif
+#ifdef USB_CAPTURE
+    set_usb_capture(true);
+#endif
+#ifdef PHASE_ALIGN
+    set_phase_alignment(true, DEFAULT_LOOP_LATENCY_US, DEFAULT_PHASE_OFFSET);
+#endif
     
     // 2. Hardware Setup
     // Configure ADC to feed the DMA buffer
@@ -51,55 +396,52 @@ int main() {
     // Enable DMA Interrupts
     irq_set_exclusive_handler(DMA_IRQ_1, dma_isr);
     irq_set_enabled(DMA_IRQ_1, true);
+    boot_stage("input");
     
-    // Configure I2S Output (PIO based)
-    set_i2s();
-    connect_o_buffers();
-    printf("[System] Audio Output Configured\n");
-
-    // 3. Buffer Priming (Crucial for I2S Stability)
-    // We manually fill the buffer pool BEFORE starting the hardware.
-    // This prevents the I2S engine from reading empty memory (underflow) at startup.
-    printf("[System] Priming Audio Buffers...\n");
-    for (int i = 0; i < NUM_PRIME_BUFFERS; i++) {
-        fetch_o_samples(Kp);
-    }
+    // 3. Audio Output (Configure, Prime, Start I2S Clock)
+#ifdef DUAL_CORE
+    multicore_launch_core1(core1_main);
+#ifdef PARALLEL_RENDER
+    start_render_helper();
+#endif
+#else
+#ifdef PARALLEL_RENDER
+    multicore_launch_core1(core1_main);
+#endif
+    start_audio_output();
+#endif
+#ifdef PARALLEL_RENDER
+    set_parallel_render(true);
+#endif
+    boot_stage("output");
 
     // 4. Critical Startup Sequence
     // Order matters: DMA must be listening before ADC starts firing.
-    dma_channel_start(adc_dma_chan); // 1. Arm DMA
+    input_capture_start();           // 1. Arm DMA
     adc_run(true);                   // 2. Start ADC
-    audio_i2s_set_enabled(true);     // 3. Start I2S Clock
+    boot_stage("capture");
     
     printf("[System] Real-Time Loop Running...\n");
 
     // Setup Status LED
     gpio_init(STATUS_LED_PIN);
     gpio_set_dir(STATUS_LED_PIN, GPIO_OUT);
-    uint32_t last_blink_time = 0;
 
     // --- 5. Main Real-Time Loop ---
-    while (true) {
-        // A. Audio Synthesis
-        // Generates the next block of audio samples based on current state.
-        fetch_o_samples(Kp); 
-
-        // B. Spectral Analysis (Event Driven)
-        // If the DMA has filled a new input buffer (new_data_ready), process it.
-        // This runs asynchronously to the audio generation.
-        if (new_data_ready) {
-            new_data_ready = false; 
-            
-            // Perform FFT and update synth parameters
-            analyze_audio_segment(inactive_adc_dma_buffer);
-        }
-
-        // C. Heartbeat LED (Non-blocking)
-        uint32_t now = to_ms_since_boot(get_absolute_time());
-        if (now - last_blink_time > 500) {
-            gpio_put(STATUS_LED_PIN, !gpio_get(STATUS_LED_PIN));
-            last_blink_time = now;
-        }
-    }
+#if !defined(DUAL_CORE) && !defined(IRQ_REFILL)
+    sched_add_event("audio", audio_task, audio_ready, AUDIO_DEADLINE_US);
+#endif
+    sched_add_event("analysis", analysis_task, analysis_ready, ANALYSIS_DEADLINE_US);
+    sched_add_event("timbre", timbre_task, synth_table_build_ready, TIMBRE_DEADLINE_US);
+    sched_add_periodic("led", led_task, LED_BLINK_MS * 1000, LED_BLINK_MS * 1000);
+    sched_add_event("boot", boot_report_task, boot_report_ready, LED_BLINK_MS * 1000);
+#ifdef CLOCK_GOVERNOR
+    sched_add_periodic("governor", governor_task, GOV_INTERVAL_MS * 1000, GOV_INTERVAL_MS * 1000);
+#endif
+#ifdef PRINT_TELEMETRY
+    sched_add_periodic("telemetry", telemetry_task, TELEMETRY_INTERVAL_MS * 1000, TELEMETRY_INTERVAL_MS * 1000);
+#endif
+    sched_run();
+
     return 0;
 }
\ No newline at end of file
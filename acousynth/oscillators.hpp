@@ -0,0 +1,235 @@
+/**
+ * File: oscillators.hpp
+ * Description: Per-voice oscillator kernels for the synthesis hot path.
+ * Header-only so the render loop and the benchmarks run the exact same code.
+ *
+ * One template loop, specialized on two compile-time policies:
+ *   Source - where samples come from (table lookup or interpolated, crossfade
+ *            between two tables, or the recursive sine)
+ *   Amp    - envelope ramp or constant amplitude
+ * Each instantiation carries only the code its policies need. The render
+ * loop picks one per voice and block from OSC_KERNELS (osc_kernel_for).
+ *
+ * GCC ignores section attributes on template instantiations, so the template
+ * is force-inlined into one plain __not_in_flash_func wrapper per pair of
+ * policies (OSC_KERNEL): that is what keeps the kernels out of flash.
+ */
+
+#ifndef OSCILLATORS_H
+#define OSCILLATORS_H
+
+#include "macros.hpp"
+#include "input_config.hpp" // For FreqData
+#include <math.h>
+
+// Per-voice headroom before the final mix: (Sample * Amp) >> VOICE_HEADROOM_SHIFT
+// Overs are handled by the output stage (limiter + soft clip), so a single
+// voice can reach half scale.
+constexpr int VOICE_HEADROOM_SHIFT = 1;
+
+// Recursive oscillator amplitude in Q31 (leaves rounding headroom below 1.0).
+// Same peak as a pure-sine synth table, which has no Gibbs headroom.
+constexpr int32_t SINE_OSC_AMP_Q31 = 0x7FFF0000;
+constexpr float   Q31_ONE = 2147483648.0f;
+constexpr float   DDS_PHASE_TO_RAD = (float)(TWO_PI / two32);
+
+// Fractional table position for interpolation (Q15 below the index bits)
+constexpr int INTERP_FRAC_SHIFT = PHASE_SHIFT - 15;
+
+// --- Per-Block Kernel Inputs ---
+// The envelope is a linear ramp across the block: amp_q16 is the level at the
+// first sample (Q15 level << 16), amp_step the per-sample change (see
+// env_ramp_step). Kernels only advance the voice's phase.
+typedef struct OscBlock {
+    const int16_t *table;       // Band-limited table for the voice's mip level
+    const int16_t *prev_table;  // Crossfade only: table being faded out (same level)
+    int32_t amp_q16;
+    int32_t amp_step;
+    int32_t xfade_q24;          // Crossfade only: weight of 'table' at the first sample
+    int32_t xfade_step;
+} OscBlock;
+
+// --- Table Read Policies ---
+
+// Nearest lower entry (truncated phase)
+struct LookupRead {
+    static inline int32_t read(const int16_t *table, uint32_t ap) {
+        return table[(ap >> PHASE_SHIFT) & WAVETABLE_MASK];
+    }
+};
+
+// Linear interpolation between neighbouring entries (lower truncation spurs)
+struct InterpRead {
+    static inline int32_t read(const int16_t *table, uint32_t ap) {
+        uint32_t idx = ap >> PHASE_SHIFT;
+        int32_t frac = (int32_t)((ap >> INTERP_FRAC_SHIFT) & 0x7FFF);
+        int32_t s0 = table[idx];
+        int32_t s1 = table[(idx + 1) & WAVETABLE_MASK];
+        return s0 + (((s1 - s0) * frac) >> 15);
+    }
+};
+
+// --- Source Policies ---
+
+template <typename Read>
+struct TableSource {
+    const int16_t *table;
+
+    inline TableSource(const FreqData *, const OscBlock *b) : table(b->table) {}
+    inline int32_t next(uint32_t ap) { return Read::read(table, ap); }
+};
+
+// Timbre change in progress: same phase, two tables, Q14 blend so
+// (to - from) * w stays within 32 bits
+template <typename Read>
+struct XfadeSource {
+    const int16_t *from;
+    const int16_t *to;
+    int32_t w;
+    int32_t dw;
+
+    inline XfadeSource(const FreqData *, const OscBlock *b)
+        : from(b->prev_table), to(b->table), w(b->xfade_q24), dw(b->xfade_step) {}
+    inline int32_t next(uint32_t ap) {
+        int32_t a = Read::read(from, ap);
+        int32_t b = Read::read(to, ap);
+        int32_t s = a + (((b - a) * (w >> 10)) >> 14);
+        w += dw;
+        return s;
+    }
+};
+
+/**
+ * Recursive sine oscillator (magic circle / coupled form) in Q31.
+ *
+ *   s[n+1] = s[n] + e * c[n]
+ *   c[n+1] = c[n] - e * s[n+1],     e = 2 sin(w/2)
+ *
+ * Exact solution: s[n] = A sin(phi_n), c[n] = A cos(phi_n + w/2), so the state
+ * is reseeded from the DDS phase once per block. That renormalizes the
+ * amplitude (no drift from rounding) and keeps the voice phase-locked to
+ * accumalated_phase, so it can switch to and from the table path seamlessly.
+ * No table lookup means no phase-truncation spurs.
+ */
+struct RecursiveSineSource {
+    int32_t e, s, c;
+
+    inline RecursiveSineSource(const FreqData *v, const OscBlock *) {
+        // Block-rate reseed (renormalization)
+        float w = (float)v->increment_j * DDS_PHASE_TO_RAD;
+        float phi = (float)v->accumalated_phase * DDS_PHASE_TO_RAD;
+        e = (int32_t)(2.0f * sinf(0.5f * w) * Q31_ONE);
+        s = (int32_t)(sinf(phi) * (float)SINE_OSC_AMP_Q31);
+        c = (int32_t)(cosf(phi + 0.5f * w) * (float)SINE_OSC_AMP_Q31);
+    }
+    inline int32_t next(uint32_t) {
+        int32_t out = s >> 16; // Q31 -> Q15
+        s += (int32_t)(((int64_t)e * c) >> 31);
+        c -= (int32_t)(((int64_t)e * s) >> 31);
+        return out;
+    }
+};
+
+// --- Amplitude Policies ---
+
+struct RampAmp {
+    int32_t amp, step;
+
+    inline RampAmp(const OscBlock *b) : amp(b->amp_q16), step(b->amp_step) {}
+    inline int32_t next() {
+        int32_t a = amp >> 16;
+        amp += step;
+        return a;
+    }
+};
+
+// Flat envelope for the whole block (sustained voices): no per-sample add
+struct ConstAmp {
+    int32_t amp;
+
+    inline ConstAmp(const OscBlock *b) : amp(b->amp_q16 >> 16) {}
+    inline int32_t next() { return amp; }
+};
+
+// --- Kernel Template ---
+
+/**
+ * @brief Renders one block of a voice into the mix and stores its phase back.
+ * Only called through the OSC_KERNEL wrappers below.
+ */
+template <typename Source, typename Amp>
+static __force_inline void osc_kernel(FreqData *v, const OscBlock *b, int32_t *mix_buffer, uint num_samples) {
+    // Load Frequency State
+    uint32_t ap = v->accumalated_phase;
+    uint32_t inc = v->increment_j;
+    Source source(v, b);
+    Amp amp(b);
+
+    // Sample Generation Loop
+    for (uint i = 0; i < num_samples; i++) {
+        // 1. Sample & Amplitude
+        int32_t wave_sample = source.next(ap);
+        int32_t current_amp = amp.next();
+
+        // 2. Apply Amplitude, with headroom before the final mix
+        int32_t product = (wave_sample * current_amp) >> VOICE_HEADROOM_SHIFT;
+
+        // 3. Accumulate into Mix Buffer (Q15 adjustment)
+        mix_buffer[i] += (product >> 15);
+
+        // 4. Advance Phase
+        ap += inc;
+    }
+
+    // Save State for next block
+    v->accumalated_phase = ap;
+}
+
+// --- Dispatch ---
+
+typedef enum {
+    OSC_TABLE = 0,          // Table, nearest entry
+    OSC_TABLE_INTERP,       // Table, linear interpolation
+    OSC_XFADE,              // Two tables (timbre crossfade), nearest entry
+    OSC_XFADE_INTERP,       // Two tables, linear interpolation
+    OSC_RECURSIVE,          // Recursive sine (pure-sine timbre)
+    OSC_SOURCE_COUNT
+} Osc_Source;
+
+typedef void (*osc_kernel_fn)(FreqData *v, const OscBlock *b, int32_t *mix_buffer, uint num_samples);
+
+// One SRAM-resident kernel per pair of policies
+#define OSC_KERNEL(name, Source, Amp) \
+    static void __not_in_flash_func(name)(FreqData *v, const OscBlock *b, int32_t *mix_buffer, uint num_samples) { \
+        osc_kernel<Source, Amp>(v, b, mix_buffer, num_samples); \
+    }
+
+OSC_KERNEL(osc_table_const,         TableSource<LookupRead>, ConstAmp)
+OSC_KERNEL(osc_table_ramp,          TableSource<LookupRead>, RampAmp)
+OSC_KERNEL(osc_table_interp_const,  TableSource<InterpRead>, ConstAmp)
+OSC_KERNEL(osc_table_interp_ramp,   TableSource<InterpRead>, RampAmp)
+OSC_KERNEL(osc_xfade_const,         XfadeSource<LookupRead>, ConstAmp)
+OSC_KERNEL(osc_xfade_ramp,          XfadeSource<LookupRead>, RampAmp)
+OSC_KERNEL(osc_xfade_interp_const,  XfadeSource<InterpRead>, ConstAmp)
+OSC_KERNEL(osc_xfade_interp_ramp,   XfadeSource<InterpRead>, RampAmp)
+OSC_KERNEL(osc_recursive_const,     RecursiveSineSource,     ConstAmp)
+OSC_KERNEL(osc_recursive_ramp,      RecursiveSineSource,     RampAmp)
+
+// [source][0 = constant amplitude, 1 = envelope ramp]
+static const osc_kernel_fn OSC_KERNELS[OSC_SOURCE_COUNT][2] = {
+    { osc_table_const,         osc_table_ramp },
+    { osc_table_interp_const,  osc_table_interp_ramp },
+    { osc_xfade_const,         osc_xfade_ramp },
+    { osc_xfade_interp_const,  osc_xfade_interp_ramp },
+    { osc_recursive_const,     osc_recursive_ramp },
+};
+
+/**
+ * @brief Kernel for one voice and block.
+ * @param ramp true if the envelope moves during the block (amp_step != 0)
+ */
+static inline osc_kernel_fn osc_kernel_for(Osc_Source source, bool ramp) {
+    return OSC_KERNELS[source][ramp ? 1 : 0];
+}
+
+#endif // OSCILLATORS_H
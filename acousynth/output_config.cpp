@@ -1,51 +1,130 @@
 #include "output_config.hpp"
 #include "macros.hpp"
-#include "analysis.hpp" // For frq_array access
+#include "input_config.hpp" // For frq_array access
+#include "control_queue.hpp"  // Analysis results
 #include "wavetables.hpp" // For current_wave_table access
+#include "ifft_synth.hpp"  // Spectral engine for dense voice sets
+#include "oscillators.hpp" // Per-voice render kernels
+#include "envelope.hpp"    // Per-voice ADSR
+#include "output_stage.hpp" // Limiter & soft clip
+#include "clock_governor.hpp" // Clock switches at block boundaries
+#include "pico/multicore.h"  // Render helper job handoff (SIO FIFO)
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include <math.h>       // For floorf
 #include <string.h>     // For memset
 
+static_assert(O_BLOCK_MIN % LIMITER_CHUNK == 0 && O_BLOCK_STEP % LIMITER_CHUNK == 0,
+              "Adaptive block lengths must hold whole limiter chunks");
+static_assert(O_BUFFER_SIZE % O_BLOCK_STEP == 0, "Block length steps must reach O_BUFFER_SIZE");
+
 // --- Internal Driver State ---
 static audio_format_t audio_format;
 static audio_i2s_config_t i2s_config;
 static audio_buffer_format_t output_buffer_format;
 static audio_buffer_pool_t *output_pool;
 
+// --- Voice Budget & Telemetry State ---
+static int max_polyphony = DEFAULT_MAX_POLYPHONY;
+static OutputStats output_stats;
+static Synth_Engine active_engine = ENGINE_OSC;
+static bool osc_interpolate = false;
+
+// Playout clock: estimated time at which the last queued block finishes playing.
+// If a new block is handed over after this point, the I2S has run dry.
+static bool     stream_started = false;
+static uint32_t primed_us = 0;
+static uint32_t playout_end_us = 0;
+static uint32_t last_pool_full_us = 0;
+static bool     pool_was_full = false;
+static uint32_t given_block_us[O_POOL_MAX];  // Durations of the last blocks handed over
+static uint     given_blocks = 0;
+
+// Output buffering: buffers beyond pool_depth are parked (held out of circulation)
+static int      pool_depth = O_POOL_SIZE;
+static uint     block_len = O_BUFFER_SIZE;
+static bool     adaptive_buffering = false;
+static audio_buffer_t *parked_buffers[O_POOL_MAX];
+static int      num_parked = 0;
+static uint32_t last_grow_us = 0;
+static uint32_t calm_start_us = 0;
+static uint32_t peak_load_pct = 0;           // Worst render time / block period since calm_start_us
+
+// Render list: voices the oscillator bank renders this block
+typedef struct RenderItem {
+    FreqData *v;
+    int16_t start_level;
+    int16_t end_level;
+} RenderItem;
+
+static RenderItem render_list[NUM_FREQS];
+static int render_count = 0;
+
+// Parallel rendering: the other core renders every second voice of the list
+// into its own mix from its SIO FIFO interrupt. The FIFO carries the job
+// (voice count) one way and the helper's dropped-voice count back, which is
+// also the end-of-block barrier.
+static volatile bool helper_ready = false;
+static bool     parallel_render = false;
+static int32_t  HELPER_CORE_SCRATCH("helper_mix") helper_mix[O_BUFFER_SIZE];
+static uint     job_num_samples = 0;
+static uint32_t job_start_us = 0;
+static uint32_t job_budget_us = 0;
+
+// Interrupt-driven refill (user IRQ pended from the audio DMA interrupt)
+static int      refill_irq = -1;
+
+// Event-driven refill (flag set from the audio DMA interrupt, see scheduler.hpp)
+static volatile bool refill_event = false;
+
+// Phase alignment
+static bool     phase_align = false;
+static uint32_t loop_latency_us = DEFAULT_LOOP_LATENCY_US;
+static uint32_t phase_offset = DEFAULT_PHASE_OFFSET;
+
 // --- 1. Initialization Logic ---
 
-void increment_init() {
-    printf("[Synth] Initializing Phase Increments...\n");
-    
+// Phase increment of every FFT bin, computed by the compiler (flash)
+static constexpr std::array<uint32_t, NUM_FREQS> make_bin_increments() {
     // Frequency resolution of the FFT bins based on Input Sample Rate
     // Note: FS_I is low (1255 Hz), so bins are very fine (~2.4 Hz).
-    float freq_resolution = (float)FS_I / (float)FFT_SIZE; 
-    
-    // Direct Digital Synthesis (DDS) Constant: 2^32 / Fs_out
-    // Maps a target Hz value to a 32-bit phase step per sample.
-    double dds_factor = two32 / (double)FS_O;
+    std::array<uint32_t, NUM_FREQS> t{};
+    float freq_resolution = (float)FS_I / (float)FFT_SIZE;
+    for (int k = 0; k < NUM_FREQS; k++) {
+        t[k] = (uint32_t)(k * freq_resolution * DDS_FACTOR);
+    }
+    return t;
+}
+static constexpr std::array<uint32_t, NUM_FREQS> BIN_INCREMENTS = make_bin_increments();
+
+// Phase increment of FFT bin k
+static inline uint32_t bin_increment(int k) {
+    return BIN_INCREMENTS[k];
+}
+
+void increment_init() {
+    printf("[Synth] Initializing Phase Increments...\n");
 
     for (int k = 0; k < NUM_FREQS; k++) {
-        float freq_hz = k * freq_resolution;
-        
         // Calculate phase increment for this specific bin frequency
-        frq_array[k].increment_j = (uint32_t)(freq_hz * dds_factor);
+        frq_array[k].increment_j = bin_increment(k);
         
         // Clear state
         frq_array[k].play = false;
         frq_array[k].accumalated_phase = 0;
         frq_array[k].amp = 0;
-        frq_array[k].current_amp = 0.0f;
-        frq_array[k].amp_float = 0.0f;
-        frq_array[k].is_peak = false;
+        env_reset(&frq_array[k]);
         frq_array[k].env_phase = 0;
-        frq_array[k].stability = 0;
+        frq_array[k].stolen = false;
+        frq_array[k].phase_valid = false;
     }
 }
 
 void set_i2s() {
-    // Define format: 16-bit Stereo @ 44.1kHz
+    // Define format: 16-bit Mono/Stereo @ FS_O
     audio_format.format = AUDIO_BUFFER_FORMAT_PCM_S16;
     audio_format.sample_freq = FS_O;
-    audio_format.channel_count = 2;
+    audio_format.channel_count = O_CHANNELS;
 
     // Configure PIO Pins
     i2s_config.data_pin = I2S_DATA_PIN;
@@ -58,111 +137,648 @@ void set_i2s() {
     if (!ret) {
         panic("Pico Audio I2S Setup Failed!");
     }
+    printf("[Synth] I2S Output: %d Hz, %s, %d-sample blocks\n", FS_O,
+           (O_CHANNELS == 1) ? "mono" : "stereo", O_BUFFER_SIZE);
 }
 
 void connect_o_buffers() {
-    // Define Buffer Format (S16 Stereo = 4 bytes per sample)
+    // Define Buffer Format (S16 = 2 bytes per sample and channel)
     output_buffer_format.format = &audio_format;
-    output_buffer_format.sample_stride = 4;
+    output_buffer_format.sample_stride = 2 * O_CHANNELS;
 
-    // Create Pool: 3 buffers of size O_BUFFER_SIZE
-    // 3 buffers allow: [1 Playing] [1 Ready] [1 Being Filled]
-    output_pool = audio_new_producer_pool(&output_buffer_format, 3, O_BUFFER_SIZE);
+    // Create Pool: O_POOL_MAX buffers of size O_BUFFER_SIZE, of which
+    // pool_depth circulate (default 3: [1 Playing] [1 Ready] [1 Being Filled])
+    output_pool = audio_new_producer_pool(&output_buffer_format, O_POOL_MAX, O_BUFFER_SIZE);
 
-    if (!audio_i2s_connect(output_pool)) {
+    // Short I2S-side buffers, so blocks shorter than O_BUFFER_SIZE are not
+    // regrouped into longer DMA transfers (which would add latency back)
+    if (!audio_i2s_connect_extra(output_pool, false, O_CONSUMER_BUFFERS, O_BLOCK_MIN, NULL)) {
         panic("Failed to connect I2S producer pool");
     }
 }
 
+void start_o_stream() {
+    audio_i2s_set_enabled(true);
+
+    // The primed buffers start playing now
+    playout_end_us = time_us_32() + primed_us;
+    output_stats.stream_start_us = time_us_32();
+    output_stats.min_headroom_us = INT32_MAX;
+    output_stats.pool_depth = pool_depth;
+    output_stats.block_len = block_len;
+    calm_start_us = time_us_32();
+    stream_started = true;
+}
+
+static uint round_block_len(uint len) {
+    len = (len / O_BLOCK_STEP) * O_BLOCK_STEP;
+    if (len < O_BLOCK_MIN) len = O_BLOCK_MIN;
+    if (len > O_BUFFER_SIZE) len = O_BUFFER_SIZE;
+    return len;
+}
+
+void set_output_buffering(int depth, uint len) {
+    if (depth < O_POOL_MIN) depth = O_POOL_MIN;
+    if (depth > O_POOL_MAX) depth = O_POOL_MAX;
+    pool_depth = depth;
+    block_len = round_block_len(len);
+    adaptive_buffering = false;
+    printf("[Synth] Output buffering: %d x %u samples (%lu us)\n", pool_depth, block_len,
+           (unsigned long)(pool_depth * o_block_us(block_len)));
+}
+
+void set_adaptive_buffering(bool enable) {
+    adaptive_buffering = enable;
+    calm_start_us = time_us_32();
+    peak_load_pct = 0;
+    printf("[Synth] Adaptive output buffering %s\n", enable ? "ON" : "OFF");
+}
+
+uint32_t get_output_latency_us() {
+    int32_t queued = (int32_t)(playout_end_us - time_us_32());
+    return ((queued > 0) ? (uint32_t)queued : 0) + OUTPUT_STAGE_DELAY_US;
+}
+
+int32_t get_output_refill_due_us() {
+    // With the pool full, the oldest queued block is the first to come back:
+    // it ends where the newer pool_depth - 1 blocks behind it begin
+    uint32_t queued_after_oldest = 0;
+    for (int i = 1; i < pool_depth; i++) {
+        queued_after_oldest += given_block_us[(given_blocks - i) % O_POOL_MAX];
+    }
+    return (int32_t)(playout_end_us - queued_after_oldest - time_us_32());
+}
+
+void set_max_polyphony(int max_voices) {
+    if (max_voices < 1) max_voices = 1;
+    if (max_voices > NUM_FREQS) max_voices = NUM_FREQS;
+    max_polyphony = max_voices;
+}
+
+void set_osc_interpolation(bool enable) {
+    osc_interpolate = enable;
+}
+
+void set_parallel_render(bool enable) {
+    parallel_render = enable;
+    printf("[Synth] Parallel voice rendering %s\n", enable ? "ON" : "OFF");
+}
+
+void set_phase_alignment(bool enable, uint32_t latency_us, uint32_t offset) {
+    loop_latency_us = latency_us;
+    phase_offset = offset;
+    if (phase_align && !enable) {
+        // Back to the bin frequencies
+        for (int k = 0; k < NUM_FREQS; k++) {
+            frq_array[k].increment_j = bin_increment(k);
+        }
+    }
+    phase_align = enable;
+    printf("[Synth] Phase alignment %s (latency %lu us, offset %.0f deg)\n", enable ? "ON" : "OFF",
+           (unsigned long)latency_us, offset * (360.0 / two32));
+}
+
+const OutputStats* get_output_stats() {
+    return &output_stats;
+}
+
 // --- 2. Synthesis Engine (The Hot Path) ---
 
+// Ranking key for voice stealing: the louder of where the voice is and where it is heading
+static inline int32_t voice_rank(const FreqData *v) {
+    int32_t target = v->play ? v->amp : 0;
+    int32_t current = v->current_amp;
+    return (target > current) ? target : current;
+}
+
+// Min-heap on rank over order[0..n): restores the heap below entry i
+static inline void heap_sift_down(uint16_t *order, int32_t *rank, int n, int i) {
+    while (true) {
+        int smallest = i;
+        int l = 2 * i + 1;
+        int r = l + 1;
+        if (l < n && rank[l] < rank[smallest]) smallest = l;
+        if (r < n && rank[r] < rank[smallest]) smallest = r;
+        if (smallest == i) return;
+        uint16_t o = order[i]; order[i] = order[smallest]; order[smallest] = o;
+        int32_t k = rank[i]; rank[i] = rank[smallest]; rank[smallest] = k;
+        i = smallest;
+    }
+}
+
+// Collects all audible voices into 'order': the loudest max_polyphony first,
+// loudest to quietest, then the ones over the limit (unordered). Returns the count.
+// The loudest are kept in a min-heap of max_polyphony entries (its root is the
+// quietest kept voice), so the cost is O(n log max_polyphony), not O(n^2).
+static int __not_in_flash_func(collect_voices)(uint16_t *order, int32_t *rank) {
+    int kept = 0;   // Heap of the loudest voices, order[0..kept)
+    int over = 0;   // Voices over the limit, order[NUM_FREQS - over..NUM_FREQS)
+    for (int j = 0; j < NUM_FREQS; j++) {
+        const FreqData *v = &frq_array[j];
+        // Skip silent frequencies, but keep the release tail.
+        // A stolen voice is out once its fast release has finished.
+        if (v->env_stage == ENV_IDLE && (!v->play || v->stolen)) {
+            continue;
+        }
+
+        int32_t r = voice_rank(v);
+        uint16_t spill = (uint16_t)j;
+        int32_t spill_rank = r;
+        if (kept < max_polyphony) {
+            // Heap not full: sift the new voice up
+            int pos = kept++;
+            while (pos > 0 && rank[(pos - 1) / 2] > r) {
+                order[pos] = order[(pos - 1) / 2];
+                rank[pos] = rank[(pos - 1) / 2];
+                pos = (pos - 1) / 2;
+            }
+            order[pos] = (uint16_t)j;
+            rank[pos] = r;
+            continue;
+        }
+        if (r > rank[0]) {
+            // Louder than the quietest kept voice: that one goes over the limit
+            spill = order[0];
+            spill_rank = rank[0];
+            order[0] = (uint16_t)j;
+            rank[0] = r;
+            heap_sift_down(order, rank, kept, 0);
+        }
+        over++;
+        order[NUM_FREQS - over] = spill;
+        rank[NUM_FREQS - over] = spill_rank;
+    }
+
+    // Heap sort: moving the quietest to the back leaves the kept voices loudest first
+    for (int n = kept - 1; n > 0; n--) {
+        uint16_t o = order[0]; order[0] = order[n]; order[n] = o;
+        int32_t k = rank[0]; rank[0] = rank[n]; rank[n] = k;
+        heap_sift_down(order, rank, n, 0);
+    }
+
+    // Voices over the limit follow the kept ones
+    for (int i = 0; i < over; i++) {
+        order[kept + i] = order[NUM_FREQS - over + i];
+        rank[kept + i] = rank[NUM_FREQS - over + i];
+    }
+    return kept + over;
+}
+
+// Renders one voice into the mix buffer.
+// The kernel is picked per block: table state (crossfade / pure sine / table),
+// interpolation setting, and whether the envelope moves during the block.
+// The envelope ramps linearly from start_level to end_level across the block.
+static inline void render_voice(FreqData *v, int32_t *mix_buffer, uint num_samples, int16_t start_level, int16_t end_level) {
+    OscBlock block;
+    block.amp_q16 = (int32_t)start_level << 16;
+    block.amp_step = env_ramp_step(start_level, end_level, num_samples);
+
+    // Band-limited table for this voice's octave, chosen once per block
+    int level_offset = wavetable_mip_level(v->increment_j) * WAVETABLE_LEN;
+    block.table = current_wave_table + level_offset;
+
+    Osc_Source source;
+    if (previous_wave_table) {
+        // Timbre change in progress: fade between the old and new tables
+        block.prev_table = previous_wave_table + level_offset;
+        block.xfade_q24 = wavetable_xfade_q24;
+        block.xfade_step = wavetable_xfade_step;
+        source = osc_interpolate ? OSC_XFADE_INTERP : OSC_XFADE;
+    } else if (synth_table_is_sine) {
+        source = OSC_RECURSIVE;
+    } else {
+        source = osc_interpolate ? OSC_TABLE_INTERP : OSC_TABLE;
+    }
+
+    osc_kernel_for(source, block.amp_step != 0)(v, &block, mix_buffer, num_samples);
+}
+
+// Renders every stride-th entry of the render list, starting at 'first'.
+// Budget Governor: once the deadline is near, skip the remaining (quietest) voices.
+// Their phase keeps running so they re-enter without a discontinuity.
+// Returns the number of voices skipped.
+static uint32_t __not_in_flash_func(render_voice_list)(int first, int stride, int32_t *mix_buffer, uint num_samples,
+                                  uint32_t start_us, uint32_t budget_us) {
+    uint32_t dropped = 0;
+    for (int n = first; n < render_count; n += stride) {
+        const RenderItem *item = &render_list[n];
+        FreqData *v = item->v;
+
+        if (time_us_32() - start_us > budget_us) {
+            // The envelope has already advanced: the voice picks up at its level
+            v->accumalated_phase += v->increment_j * num_samples;
+            dropped++;
+            continue;
+        }
+        render_voice(v, mix_buffer, num_samples, item->start_level, item->end_level);
+    }
+    return dropped;
+}
+
+// Render helper (runs on the other core): odd entries of the render list
+static void __not_in_flash_func(render_helper_isr)() {
+    while (multicore_fifo_rvalid()) {
+        multicore_fifo_pop_blocking(); // Job token
+        memset(helper_mix, 0, job_num_samples * sizeof(int32_t));
+        uint32_t dropped = render_voice_list(1, 2, helper_mix, job_num_samples, job_start_us, job_budget_us);
+        __dmb(); // helper_mix and voice state are visible before the reply
+        multicore_fifo_push_blocking(dropped);
+    }
+    multicore_fifo_clear_irq();
+}
+
+void start_render_helper() {
+    uint irq = get_core_num() ? SIO_IRQ_PROC1 : SIO_IRQ_PROC0;
+    multicore_fifo_drain();
+    multicore_fifo_clear_irq();
+    irq_set_exclusive_handler(irq, render_helper_isr);
+    irq_set_enabled(irq, true);
+    helper_ready = true;
+    printf("[Synth] Render helper on core %u\n", get_core_num());
+}
+
+// Renders the render list into mix_buffer, split across both cores when enabled.
+// Returns the number of voices the budget governor skipped.
+static uint32_t __not_in_flash_func(render_oscillators)(int32_t *mix_buffer, uint num_samples, uint32_t start_us, uint32_t budget_us) {
+    bool split = parallel_render && helper_ready && render_count >= PARALLEL_MIN_VOICES;
+    if (!split) {
+        return render_voice_list(0, 1, mix_buffer, num_samples, start_us, budget_us);
+    }
+
+    // 1. Hand the odd entries to the helper
+    job_num_samples = num_samples;
+    job_start_us = start_us;
+    job_budget_us = budget_us;
+    __dmb();
+    multicore_fifo_push_blocking((uint32_t)render_count);
+
+    // 2. Even entries here, in parallel
+    uint32_t dropped = render_voice_list(0, 2, mix_buffer, num_samples, start_us, budget_us);
+
+    // 3. Barrier, then sum the helper's mix
+    dropped += multicore_fifo_pop_blocking();
+    __dmb();
+    for (uint i = 0; i < num_samples; i++) {
+        mix_buffer[i] += helper_mix[i];
+    }
+    return dropped;
+}
+
+// Steers a voice onto the measured string phase for this block (phase_align.hpp)
+static void __not_in_flash_func(align_voice_phase)(FreqData *v, uint32_t play_us, uint num_samples) {
+    phase_align_increment(v->string_freq_hz, v->string_phase, v->string_phase_us, v->accumalated_phase,
+                          play_us, loop_latency_us, phase_offset, num_samples, &v->increment_j);
+}
+
+// Picks the engine for this block. Returns true if it changed (crossfade block).
+static bool __not_in_flash_func(select_engine)(int num_voices) {
+    Synth_Engine prev = active_engine;
+    if (active_engine == ENGINE_OSC && num_voices >= IFFT_ENGINE_ON_VOICES) {
+        active_engine = ENGINE_IFFT;
+    } else if (active_engine == ENGINE_IFFT && num_voices <= IFFT_ENGINE_OFF_VOICES) {
+        active_engine = ENGINE_OSC;
+    }
+    return active_engine != prev;
+}
+
+// Narrows the output stage result into the I2S buffer
+static inline void write_o_frames(int16_t *samples, const int32_t *mix_buffer, uint num_samples) {
+#if ACOUSYNTH_STEREO_OUTPUT
+    // Interleave: both exciters currently get the same signal. A second
+    // mix would be written to the odd (right) slots here.
+    for (uint i = 0; i < num_samples; i++) {
+        int16_t out_val = (int16_t)mix_buffer[i];
+        samples[i*2]     = out_val;
+        samples[i*2 + 1] = out_val;
+    }
+#else
+    // Mono: one write per sample, L/R duplication happens in the I2S DMA
+    for (uint i = 0; i < num_samples; i++) {
+        samples[i] = (int16_t)mix_buffer[i];
+    }
+#endif
+}
+
+// Copies the newest analysis results into the voices (block boundary only,
+// so a block never sees half of one frame and half of the next)
+static void __not_in_flash_func(apply_control_frame)() {
+    const ControlFrame *frame = control_frame_receive();
+    if (!frame) return;
+
+    for (int k = 0; k < NUM_FREQS; k++) {
+        const VoiceControl *c = &frame->voice[k];
+        FreqData *v = &frq_array[k];
+        // A stolen voice competes again once its note ends or is re-plucked
+        if (!c->play || (c->env_phase == ATTACK && v->env_phase != ATTACK)) v->stolen = false;
+        v->play = c->play;
+        v->amp = c->amp;
+        v->env_phase = c->env_phase;
+        v->string_freq_hz = c->string_freq_hz;
+        v->string_phase = c->string_phase;
+        v->string_phase_us = c->string_phase_us;
+        v->phase_valid = c->phase_valid;
+    }
+    control_frame_release(frame);
+}
+
 // Internal helper to mix samples
-static void fill_o_buffer(audio_buffer_t *buffer, float Kp) {
+static void __not_in_flash_func(fill_o_buffer)(audio_buffer_t *buffer) {
     int16_t *samples = (int16_t *)buffer->buffer->bytes;
+    uint32_t block_start_us = time_us_32();
     
     // High-precision mixing buffer (32-bit to prevent overflow before clipping)
-    // Static allocation avoids stack thrashing
-    static int32_t mix_buffer[O_BUFFER_SIZE];
-    
-    // Reset mix buffer
-    memset(mix_buffer, 0, buffer->max_sample_count * sizeof(int32_t));
+    // Static allocation avoids stack thrashing; the mix and the voice order
+    // sit in the audio core's scratch bank, next to its stack. The ranks stay
+    // in striped SRAM: the bank's 4 KB already holds the 2 KB stack and these
+    // 1.5 KB, and collect_voices touches them once per block, not per sample.
+    static int32_t AUDIO_CORE_SCRATCH("mix_buffer") mix_buffer[O_BUFFER_SIZE];
+    static uint16_t AUDIO_CORE_SCRATCH("voice_order") voice_order[NUM_FREQS];
+    static int32_t voice_rank_buf[NUM_FREQS];
     
     // Safety: Don't run if wavetable isn't ready
     if (!current_wave_table) return;
 
-    // --- A. Additive Synthesis Loop ---
-    for (int j = 0; j < NUM_FREQS; j++) {
-        // Optimization: Skip silent frequencies
-        // We also check 'current_amp > 1.0' to ensure we process the full decay tail
-        if (!frq_array[j].play && frq_array[j].current_amp <= 1.0f) {
+    // Block boundary: the only place new analysis results are taken in
+    apply_control_frame();
+
+    // --- A. Voice Selection ---
+    // Loudest voices first, so the budget governor only ever drops the quiet ones
+    int num_voices = collect_voices(voice_order, voice_rank_buf);
+    int rendered = 0;
+
+    // --- B. Engine Selection ---
+    // On a switch both engines run for one block: the IFFT frame fades in (or its
+    // last tail fades out) while the oscillator bank fades the other way.
+    bool switching = select_engine(num_voices < max_polyphony ? num_voices : max_polyphony);
+    bool run_osc  = (active_engine == ENGINE_OSC) || switching;
+    bool run_ifft = (active_engine == ENGINE_IFFT);
+
+    // Block length: the IFFT engine's hop is a full buffer; the oscillator
+    // bank follows the (adaptive) block length
+    uint num_samples = (run_ifft || switching) ? O_BUFFER_SIZE : block_len;
+    uint32_t budget_us = (o_block_us(num_samples) * RENDER_BUDGET_PCT) / 100;
+    memset(mix_buffer, 0, num_samples * sizeof(int32_t));
+
+    // Timbre table swap / crossfade step (block boundary)
+    wavetable_block_boundary(num_samples);
+
+    // When this block starts playing: behind everything already queued,
+    // plus the output stage's lookahead delay
+    uint32_t play_us = block_start_us;
+    if (stream_started && (int32_t)(playout_end_us - block_start_us) > 0) {
+        play_us = playout_end_us;
+    }
+    play_us += OUTPUT_STAGE_DELAY_US;
+
+    if (run_ifft) {
+        // Timbre at the frame center (the end of this block)
+        int32_t xfade_q24 = wavetable_xfade_q24 + wavetable_xfade_step * (int32_t)num_samples;
+        if (xfade_q24 > XFADE_ONE_Q24) xfade_q24 = XFADE_ONE_Q24;
+        ifft_begin_frame();
+        ifft_set_timbre(current_harmonics, previous_harmonics, (float)xfade_q24 / (float)XFADE_ONE_Q24);
+    }
+    render_count = 0;
+
+    // --- C. Voice Control Loop ---
+    for (int n = 0; n < num_voices; n++) {
+        FreqData *v = &frq_array[voice_order[n]];
+
+        // Budget Governor: once the deadline is near, skip the remaining (quietest) voices.
+        // Their phase keeps running and their envelope fast-releases (instead of
+        // being reset), so they re-enter without a discontinuity.
+        if (time_us_32() - block_start_us > budget_us) {
+            v->accumalated_phase += v->increment_j * num_samples;
+            env_advance(v, v->amp, false, true, num_samples);
+            output_stats.dropped_voices++;
             continue;
         }
 
-        // Load Frequency State
-        uint32_t ap = frq_array[j].accumalated_phase;
-        uint32_t inc = frq_array[j].increment_j;
-        
-        // Envelope Follower Logic
-        // Target is either the live amplitude (if playing) or 0 (if stopped)
-        int16_t target_amp = frq_array[j].play ? frq_array[j].amp : 0;
-        float current_amp = frq_array[j].current_amp;
-
-        // Sample Generation Loop
-        for (uint i = 0; i < buffer->max_sample_count; i++) {
-            // 1. P-Control Envelope Smoothing
-            float error = (float)target_amp - current_amp;
-            current_amp += error * Kp;
-
-            // 2. WaveTable Lookup
-            // Use top bits of phase accumulator for index
-            // With PHASE_SHIFT=22 (32-10), we correctly map 32-bit phase to 1024 table
-            uint32_t table_index = (ap >> PHASE_SHIFT) & WAVETABLE_MASK;
-            int16_t wave_sample = current_wave_table[table_index];
-
-            // 3. Apply Amplitude (Volume)
-            // (Sample * Amp) >> 4 gives us headroom before final mix
-            int32_t product = ((int32_t)wave_sample * (int16_t)current_amp) >> 2;
-
-            // 4. Accumulate into Mix Buffer (Q15 adjustment)
-            mix_buffer[i] += (product >> 15);
-
-            // 5. Advance Phase
-            ap += inc;
+        // Envelope (ADSR, control rate)
+        // The gate follows the analysis; a re-pluck (env_phase ATTACK) retriggers.
+        // Voice Stealing: over the polyphony limit, release fast (counted once,
+        // when the voice first goes over).
+        bool stolen = (n >= max_polyphony);
+        if (stolen && !v->stolen) output_stats.stolen_voices++;
+        v->stolen = stolen;
+        int16_t start_level = v->current_amp;
+        int16_t end_level = env_advance(v, v->amp, v->play && !stolen, stolen, num_samples);
+
+        // Phase Alignment (before the phase is advanced by either engine)
+        if (phase_align && v->play && v->phase_valid) {
+            align_voice_phase(v, play_us, num_samples);
+        }
+
+        if (run_ifft) {
+            // The frame is centered on the end of this block
+            uint32_t center_phase = v->accumalated_phase + v->increment_j * num_samples;
+            if (!run_osc) {
+                // IFFT engine owns the voice: block-rate phase advance
+                v->accumalated_phase = center_phase;
+            }
+            ifft_add_partial(center_phase, v->increment_j, (float)end_level / (float)(1 << VOICE_HEADROOM_SHIFT));
         }
 
-        // Save State for next block
-        frq_array[j].accumalated_phase = ap;
-        frq_array[j].current_amp = current_amp;
+        if (run_osc) {
+            RenderItem *item = &render_list[render_count++];
+            item->v = v;
+            item->start_level = start_level;
+            item->end_level = end_level;
+        }
+        rendered++;
+    }
+
+    // --- D. Additive Synthesis (Oscillator Bank) ---
+    if (run_osc) {
+        uint32_t dropped = render_oscillators(mix_buffer, num_samples, block_start_us, budget_us);
+        output_stats.dropped_voices += dropped;
+        rendered -= (int)dropped;
     }
+
+    // --- E. Engine Output & Crossfade ---
+    if (run_ifft) {
+        if (switching) ifft_crossfade_osc(mix_buffer, false);
+        ifft_synthesize_frame(mix_buffer);
+    } else if (switching) {
+        ifft_crossfade_osc(mix_buffer, true);
+        ifft_flush_tail(mix_buffer);
+    }
+
+    uint32_t render_us = time_us_32() - block_start_us;
+    output_stats.last_render_us = render_us;
+    if (render_us > output_stats.max_render_us) output_stats.max_render_us = render_us;
+    output_stats.active_voices = rendered;
+    if (rendered > 0 && render_us > 0) {
+        output_stats.voices_per_block = (uint32_t)rendered * budget_us / render_us;
+    }
+    output_stats.engine = active_engine;
     
-    // --- B. Final Output Stage ---
-    for (uint i = 0; i < buffer->max_sample_count; i++) {
-        int32_t val = mix_buffer[i];
-        
-        // Hard Clipper / Limiter
-        if (val > 32767) val = 32767;
-        else if (val < -32767) val = -32767;
+    // --- F. Final Output Stage ---
+    // Lookahead limiter + soft clipper; the result is within +/-32767
+    output_stage_process(mix_buffer, num_samples);
+    output_stats.limiter_gain_q12 = output_limiter_gain();
 
-        int16_t out_val = (int16_t)val;
+    write_o_frames(samples, mix_buffer, num_samples);
 
-        // Interleave to Stereo (Left = Right)
-        samples[i*2]     = out_val;
-        samples[i*2 + 1] = out_val;
+    buffer->sample_count = num_samples;
+}
+
+// --- Adaptive Buffering ---
+// Called once per block with whether it underran and the block's render load
+static void adapt_buffering(bool underrun, uint32_t now, uint32_t load_pct) {
+    if (load_pct > peak_load_pct) peak_load_pct = load_pct;
+
+    if (underrun) {
+        // Grow at once, but only one step per burst of underruns
+        if (now - last_grow_us >= ADAPT_GROW_HOLDOFF_MS * 1000) {
+            if (pool_depth < O_POOL_MAX) pool_depth++;
+            else if (block_len < O_BUFFER_SIZE) block_len += O_BLOCK_STEP;
+            last_grow_us = now;
+        }
+        calm_start_us = now;
+        peak_load_pct = 0;
+        return;
     }
 
-    buffer->sample_count = buffer->max_sample_count;
+    // Shrink one step after a calm period with render headroom to spare
+    if (now - calm_start_us < ADAPT_CALM_MS * 1000) return;
+    if (peak_load_pct < ADAPT_SHRINK_LOAD_PCT) {
+        if (block_len > O_BLOCK_MIN) block_len -= O_BLOCK_STEP;
+        else if (pool_depth > O_POOL_MIN) pool_depth--;
+    }
+    calm_start_us = now;
+    peak_load_pct = 0;
 }
 
-void fetch_o_samples(float Kp) {
-    // Request free buffer (Non-blocking mode)
+// Advances the playout clock by one block and records underruns
+static void __not_in_flash_func(track_playout)(uint num_samples) {
+    uint32_t now = time_us_32();
+    uint32_t block_us = o_block_us(num_samples);
+    given_block_us[given_blocks++ % O_POOL_MAX] = block_us;
+
+    if (!stream_started) {
+        primed_us += block_us;
+        return;
+    }
+
+    // A buffer was freed right after the pool was seen full: the I2S just
+    // finished one block, so re-anchor the clock to the real queue (the
+    // blocks handed over before this one, all still in circulation)
+    if (pool_was_full && (now - last_pool_full_us) < block_us / 8) {
+        uint32_t queued_us = 0;
+        for (int i = 2; i <= pool_depth; i++) {
+            queued_us += given_block_us[(given_blocks - i) % O_POOL_MAX];
+        }
+        playout_end_us = now + queued_us;
+    }
+    pool_was_full = false;
+
+    // Headroom: audio still queued ahead of this block
+    int32_t headroom_us = (int32_t)(playout_end_us - now);
+    if (headroom_us < output_stats.min_headroom_us) output_stats.min_headroom_us = headroom_us;
+
+    // The queue ran dry before this block arrived
+    bool underrun = (headroom_us < 0);
+    if (underrun) {
+        output_stats.underruns++;
+        playout_end_us = now;
+    }
+    output_stats.latency_us = (uint32_t)(playout_end_us - now) + OUTPUT_STAGE_DELAY_US;
+    playout_end_us += block_us;
+
+    if (adaptive_buffering) {
+        adapt_buffering(underrun, now, output_stats.last_render_us * 100 / block_us);
+    }
+    output_stats.pool_depth = pool_depth;
+    output_stats.block_len = block_len;
+}
+
+// Next buffer to fill, keeping pool_depth buffers in circulation
+static audio_buffer_t *__not_in_flash_func(take_o_buffer)() {
+    // Depth grew: put a parked buffer back to work
+    if (num_parked > 0 && O_POOL_MAX - num_parked < pool_depth) {
+        return parked_buffers[--num_parked];
+    }
+
+    // Depth shrank: park free buffers until the circulation matches
     audio_buffer_t *buffer = take_audio_buffer(output_pool, false);
+    while (buffer && O_POOL_MAX - num_parked > pool_depth) {
+        parked_buffers[num_parked++] = buffer;
+        buffer = take_audio_buffer(output_pool, false);
+    }
+    return buffer;
+}
+
+bool __not_in_flash_func(fetch_o_samples)() {
+    // This call handles whatever the DMA has handed back so far
+    refill_event = false;
+
+    // Request free buffer (Non-blocking mode)
+    audio_buffer_t *buffer = take_o_buffer();
 
     if (buffer == NULL) {
-        // Buffer starvation occurred (CPU too slow or I2S too fast)
-        return; 
+        // Every buffer is queued for playback; nothing to render yet
+        pool_was_full = true;
+        last_pool_full_us = time_us_32();
+        return false;
     }
 
-    fill_o_buffer(buffer, Kp);
+    fill_o_buffer(buffer);
+    track_playout(buffer->sample_count);
 
     give_audio_buffer(output_pool, buffer);
-}
\ No newline at end of file
+
+    // Block just queued: its load for the governor, and the safe moment for
+    // a clock switch (also when the pool never fills because rendering is late)
+    governor_block_boundary(output_stats.last_render_us, buffer->sample_count);
+    return true;
+}
+
+// --- 3. Interrupt-Driven Refill ---
+
+// Deferred handler: renders until every free buffer is queued again
+static void __not_in_flash_func(refill_isr)() {
+    // Entered right after the I2S finished a block, which is exactly the
+    // moment the playout clock re-anchors on
+    pool_was_full = true;
+    last_pool_full_us = time_us_32();
+
+    while (fetch_o_samples()) {
+    }
+}
+
+// Chained after the audio library's own DMA handler (which frees the buffer)
+static void __not_in_flash_func(audio_dma_done_hook)() {
+    irq_set_pending(refill_irq);
+}
+
+void start_o_refill_irq() {
+    refill_irq = user_irq_claim_unused(true);
+    irq_set_exclusive_handler(refill_irq, refill_isr);
+    irq_set_priority(refill_irq, REFILL_IRQ_PRIORITY);
+    irq_set_enabled(refill_irq, true);
+
+    irq_add_shared_handler(DMA_IRQ_0 + PICO_AUDIO_I2S_DMA_IRQ, audio_dma_done_hook,
+                           PICO_SHARED_IRQ_HANDLER_LOWEST_ORDER_PRIORITY);
+
+    // Top up whatever is free right now; from here on the DMA drives refill
+    irq_set_pending(refill_irq);
+    printf("[Synth] Interrupt-driven refill on IRQ %d\n", refill_irq);
+}
+
+// --- 4. Event-Driven Refill ---
+
+// Chained after the audio library's own DMA handler (which frees the buffer).
+// Taking the interrupt also wakes the core from __wfe().
+static void __not_in_flash_func(audio_dma_event_hook)() {
+    refill_event = true;
+}
+
+void start_o_refill_events() {
+    irq_add_shared_handler(DMA_IRQ_0 + PICO_AUDIO_I2S_DMA_IRQ, audio_dma_event_hook,
+                           PICO_SHARED_IRQ_HANDLER_LOWEST_ORDER_PRIORITY);
+    refill_event = true; // Top up whatever is free right now
+}
+
+bool o_refill_pending() {
+    return refill_event;
+}
@@ -9,7 +9,9 @@
 #include <stdio.h>
 #include "pico/stdlib.h"
 #include "pico/audio_i2s.h"
+#include "hardware/irq.h"  // IRQ priorities
 #include "macros.hpp" // Provides FS_O and O_BUFFER_SIZE
+#include "phase_align.hpp" // Phase alignment constants
 
 // --- Hardware Configuration ---
 // These are specific to the Output implementation
@@ -17,6 +19,80 @@ constexpr uint I2S_DATA_PIN       = 9;
 constexpr uint I2S_CLOCK_PIN_BASE = 10; // BCLK on 10, LRCLK on 11
 constexpr uint O_DMA_CHANNEL      = 10;
 constexpr uint PIO_NUM            = 0;
+constexpr int  O_POOL_SIZE        = 3;    // Default buffers in circulation
+constexpr int  O_POOL_MAX         = 4;    // Buffers allocated (upper bound of the depth)
+constexpr int  O_POOL_MIN         = 2;    // One playing, one being filled
+constexpr int  O_CONSUMER_BUFFERS = 2;    // I2S-side DMA buffers (O_BLOCK_MIN samples each)
+// Interrupt-driven refill runs below the DMA interrupts (ADC ping-pong, I2S),
+// so a render never delays them, and above all main-loop work.
+constexpr uint8_t REFILL_IRQ_PRIORITY = PICO_LOWEST_IRQ_PRIORITY;
+
+// --- Output Channels ---
+// Mono: the CPU writes each sample once; the I2S DMA duplicates it to L and R.
+// Stereo (ACOUSYNTH_STEREO_OUTPUT): interleaved L/R for two exciter signals.
+#if ACOUSYNTH_STEREO_OUTPUT
+constexpr int  O_CHANNELS         = 2;
+#else
+constexpr int  O_CHANNELS         = 1;
+#endif
+
+// --- Voice Budget ---
+// Upper bound on simultaneously rendered voices (runtime adjustable).
+constexpr int DEFAULT_MAX_POLYPHONY = 24;
+// Share of one block period the oscillator bank may spend rendering.
+// The rest is left for analysis and the final output stage.
+constexpr uint RENDER_BUDGET_PCT = 70;
+// Parallel rendering only pays off above a few voices (job handoff, extra mix sum).
+constexpr int PARALLEL_MIN_VOICES = 4;
+
+// --- Engine Selection ---
+// Above this many voices the IFFT resynthesis engine is cheaper than the
+// oscillator bank (its cost does not grow with the voice count).
+// The lower threshold adds hysteresis so the engines don't flap.
+constexpr int IFFT_ENGINE_ON_VOICES  = 12;
+constexpr int IFFT_ENGINE_OFF_VOICES = 8;
+
+typedef enum {
+    ENGINE_OSC  = 0,  // Wavetable oscillator bank, O(voices x samples)
+    ENGINE_IFFT = 1   // Spectral overlap-add, O(N log N) per block
+} Synth_Engine;
+
+// --- Adaptive Buffering ---
+// Output latency is (buffers in circulation) x (block length). Both can be set
+// at runtime or left to a controller: an underrun grows buffering at once
+// (depth first, then block length); after ADAPT_CALM_MS without underruns and
+// with the render load below ADAPT_SHRINK_LOAD_PCT, it shrinks one step
+// (block length first, then depth). The IFFT engine always uses full blocks.
+constexpr uint     O_BLOCK_MIN  = 64;               // Shortest block (samples)
+constexpr uint     O_BLOCK_STEP = 64;               // Block length granularity
+constexpr uint32_t ADAPT_CALM_MS = 5000;            // Underrun-free time before a shrink step
+constexpr uint32_t ADAPT_GROW_HOLDOFF_MS = 500;     // One grow step per burst of underruns
+constexpr uint32_t ADAPT_SHRINK_LOAD_PCT = 50;      // Peak render time / block period to allow shrinking
+
+// Duration of an output block in microseconds
+static constexpr uint32_t o_block_us(uint num_samples) {
+    return (uint32_t)((num_samples * 1000000ULL) / FS_O);
+}
+// Longest block (~5.8 ms at 44.1 kHz, ~11.6 ms at 22.05 kHz)
+constexpr uint32_t O_BLOCK_US = o_block_us(O_BUFFER_SIZE);
+
+// --- Output Telemetry ---
+typedef struct OutputStats {
+    uint32_t underruns;       // I2S ran out of queued audio
+    uint32_t dropped_voices;  // Voices skipped because the render budget ran out
+    uint32_t stolen_voices;   // Voices fast-released by the polyphony limit
+    uint32_t last_render_us;  // Render time of the most recent block
+    uint32_t max_render_us;   // Worst render time since boot
+    int active_voices;        // Voices rendered in the most recent block
+    int engine;               // Synth_Engine used for the most recent block
+    int32_t limiter_gain_q12; // Output limiter gain (4096 = no reduction)
+    int32_t min_headroom_us;  // Least audio still queued when a block was handed over (worst case)
+    uint32_t voices_per_block; // Voices the render budget fits at the last block's cost per voice
+    uint32_t latency_us;      // Queued audio + output stage delay when the last block was handed over
+    int pool_depth;           // Buffers in circulation
+    uint block_len;           // Block length (samples) outside the IFFT engine
+    uint32_t stream_start_us; // time_us_32() when the I2S stream started (0 before)
+} OutputStats;
 
 // --- Public API ---
 
@@ -36,11 +112,111 @@ void set_i2s();
  */
 void connect_o_buffers();
 
+/**
+ * @brief Starts the I2S clock and anchors the playout clock used for
+ * underrun detection. Call once, after the pool has been primed.
+ */
+void start_o_stream();
+
+/**
+ * @brief Limits how many voices are rendered per block.
+ * Voices are ranked by amplitude; the quietest ones beyond the limit
+ * are fast-released (ENV_FAST_RELEASE_MS) and, once silent, are no longer
+ * rendered until their note ends or is re-plucked.
+ * @param max_voices Voice cap (clamped to 1..NUM_FREQS).
+ */
+void set_max_polyphony(int max_voices);
+
+/**
+ * @brief Selects linear interpolation for the wavetable kernels (lower
+ * phase-truncation spurs, about one extra lookup and multiply per sample).
+ * @param enable false = nearest-entry lookup (default)
+ */
+void set_osc_interpolation(bool enable);
+
+/**
+ * @brief Installs the render helper on the calling core (its SIO FIFO
+ * interrupt). Call once on the core that does not run fetch_o_samples,
+ * after core1 has been launched.
+ */
+void start_render_helper();
+
+/**
+ * @brief Splits the oscillator voices between both cores, each rendering
+ * into its own mix (summed at the end of the block). Needs start_render_helper().
+ * @param enable false = all voices on the synthesis core (default)
+ */
+void set_parallel_render(bool enable);
+
+/**
+ * @brief Enables phase-coherent resynthesis.
+ * Each playing voice tracks its measured frequency, and its phase is slewed
+ * (by trimming the increment, never by jumping) toward the string phase
+ * predicted for the moment its output reaches the string, plus phase_offset.
+ * @param enable       false restores the fixed bin frequencies
+ * @param latency_us   Output-to-string loop latency
+ * @param phase_offset Target drive phase relative to the string (2^32 = 1 cycle)
+ */
+void set_phase_alignment(bool enable, uint32_t latency_us, uint32_t phase_offset);
+
+/**
+ * @brief Sets the output buffering by hand (and turns the controller off).
+ * @param depth     Buffers in circulation (clamped to O_POOL_MIN..O_POOL_MAX)
+ * @param block_len Block length in samples (rounded to O_BLOCK_STEP, O_BLOCK_MIN..O_BUFFER_SIZE)
+ */
+void set_output_buffering(int depth, uint block_len);
+
+/**
+ * @brief Lets the controller tune depth and block length from underruns and render load.
+ */
+void set_adaptive_buffering(bool enable);
+
+/**
+ * @brief Current output latency: audio queued ahead of a new block plus the
+ * output stage delay, in microseconds.
+ */
+uint32_t get_output_latency_us();
+
+/**
+ * @brief Time until the I2S hands back its next buffer, assuming every
+ * buffer is queued (fetch_o_samples() just returned false). Negative once
+ * it is due. Lets the polling loop fit other work between refills.
+ */
+int32_t get_output_refill_due_us();
+
+/**
+ * @brief Returns the live output counters (underruns, dropped voices, timing).
+ */
+const OutputStats* get_output_stats();
+
 /**
  * @brief Main audio generation task. 
  * Fetches a free buffer, performs additive synthesis, and hands it to DMA.
- * * @param Kp Proportional gain for the envelope follower (P-Controller).
+ * Voice envelopes are set with set_synth_env() (envelope.hpp).
+ * @return true if a block was rendered, false if no buffer was free
+ */
+bool fetch_o_samples();
+
+/**
+ * @brief Moves buffer refill into a low-priority interrupt, pended each time
+ * the audio DMA finishes a block. Output then no longer depends on main-loop
+ * timing: analysis and everything else in the loop is preempted by it.
+ * Call on the audio core after start_o_stream(); afterwards fetch_o_samples()
+ * must not be called from the main loop.
+ */
+void start_o_refill_irq();
+
+/**
+ * @brief Flags each buffer the audio DMA hands back (o_refill_pending()),
+ * for a loop that sleeps between refills (scheduler.hpp). The DMA interrupt
+ * wakes the core; the loop then calls fetch_o_samples(). Call on the audio
+ * core after start_o_stream().
+ */
+void start_o_refill_events();
+
+/**
+ * @brief true if a buffer came back since the last fetch_o_samples() call.
  */
-void fetch_o_samples(float Kp);
+bool o_refill_pending();
 
 #endif // OUTPUT_CONFIG_H
\ No newline at end of file
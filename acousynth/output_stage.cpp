@@ -0,0 +1,95 @@
+/**
+ * File: output_stage.cpp
+ * Description: Soft clip table and chunked lookahead limiter.
+ *
+ * Limiter, per chunk of LIMITER_CHUNK samples:
+ *   1. The incoming chunk's peak gives the gain it needs (ceiling / peak).
+ *   2. The chunk received last time (the delayed one) is output with a gain
+ *      ramping to min(its own need, the incoming chunk's need), so the gain
+ *      is already down when the incoming peak is output. Recovery is capped
+ *      at LIMITER_RELEASE_Q12 per chunk.
+ * One division per chunk; per sample one multiply and the soft clip.
+ */
+
+#include "output_stage.hpp"
+#include "const_math.hpp"
+#include <string.h>
+
+// --- Soft Clip Table (Flash) ---
+static constexpr double ce_tanh(double u) {
+    double e = ce_exp(-2.0 * u);
+    return (1.0 - e) / (1.0 + e);
+}
+
+static constexpr std::array<int16_t, SOFTCLIP_LEN + 1> make_softclip() {
+    std::array<int16_t, SOFTCLIP_LEN + 1> t{};
+    for (int i = 0; i <= SOFTCLIP_LEN; i++) {
+        double over = (double)i * SOFTCLIP_RANGE / SOFTCLIP_LEN;
+        double y = SOFTCLIP_KNEE + SOFTCLIP_WIDTH * ce_tanh(over / SOFTCLIP_WIDTH);
+        t[i] = (int16_t)((y > 32767.0) ? 32767 : (int)(y + 0.5));
+    }
+    return t;
+}
+
+constexpr std::array<int16_t, SOFTCLIP_LEN + 1> RAM_TABLE("softclip") SOFTCLIP_TABLE = make_softclip();
+
+// --- Limiter State ---
+static bool    limiter_enabled = false;
+static int32_t delay_line[LIMITER_CHUNK];              // Last chunk received, not yet output
+static int32_t delayed_need_q12 = LIMITER_UNITY_Q12;   // Gain the delayed chunk needs
+static int32_t gain_q12 = LIMITER_UNITY_Q12;           // Gain at the end of the last output chunk
+
+// --- Public Functions ---
+
+void set_output_limiter(bool enable) {
+    limiter_enabled = enable;
+}
+
+void output_stage_reset() {
+    memset(delay_line, 0, sizeof(delay_line));
+    delayed_need_q12 = LIMITER_UNITY_Q12;
+    gain_q12 = LIMITER_UNITY_Q12;
+}
+
+int32_t output_limiter_gain() {
+    return gain_q12;
+}
+
+void __not_in_flash_func(output_stage_process)(int32_t *mix_buffer, uint num_samples) {
+    for (uint start = 0; start < num_samples; start += LIMITER_CHUNK) {
+        int32_t *chunk = &mix_buffer[start];
+
+        // 1. Peak of the incoming chunk (bounded so the gain multiply can't overflow)
+        int32_t peak = 0;
+        for (int i = 0; i < LIMITER_CHUNK; i++) {
+            int32_t x = chunk[i];
+            if (x > LIMITER_INPUT_MAX) x = LIMITER_INPUT_MAX;
+            else if (x < -LIMITER_INPUT_MAX) x = -LIMITER_INPUT_MAX;
+            chunk[i] = x;
+            int32_t a = (x < 0) ? -x : x;
+            if (a > peak) peak = a;
+        }
+
+        int32_t need_q12 = LIMITER_UNITY_Q12;
+        if (limiter_enabled && peak > LIMITER_CEILING) {
+            need_q12 = (LIMITER_CEILING << 12) / peak;
+        }
+
+        // 2. Gain target for the end of the delayed chunk
+        int32_t target = (delayed_need_q12 < need_q12) ? delayed_need_q12 : need_q12;
+        if (target > gain_q12 + LIMITER_RELEASE_Q12) target = gain_q12 + LIMITER_RELEASE_Q12;
+
+        // 3. Output the delayed chunk with a linear gain ramp (Q20), keep the incoming one
+        int32_t g = gain_q12 << 8;
+        int32_t dg = ((target - gain_q12) << 8) / LIMITER_CHUNK;
+        for (int i = 0; i < LIMITER_CHUNK; i++) {
+            g += dg;
+            int32_t in = chunk[i];
+            chunk[i] = soft_clip((delay_line[i] * (g >> 8)) >> 12);
+            delay_line[i] = in;
+        }
+
+        gain_q12 = target;
+        delayed_need_q12 = need_q12;
+    }
+}
@@ -0,0 +1,86 @@
+/**
+ * File: output_stage.hpp
+ * Description: Final stage between the 32-bit mix and the 16-bit I2S samples.
+ * A table-driven soft clipper (linear up to a knee, tanh above it) with an
+ * optional short-lookahead gain limiter in front of it. Integer only.
+ */
+
+#ifndef OUTPUT_STAGE_H
+#define OUTPUT_STAGE_H
+
+#include <stdint.h>
+#include <array>
+#include "pico/stdlib.h"
+#include "macros.hpp"
+
+// --- Soft Clip Curve ---
+// Linear below the knee; above it, knee + width * tanh(over / width).
+// The table covers SOFTCLIP_RANGE of input above the knee (tanh(4) ~ 0.9993).
+constexpr int32_t SOFTCLIP_KNEE  = 24576;                  // 0.75 full scale
+constexpr int32_t SOFTCLIP_WIDTH = 32768 - SOFTCLIP_KNEE;  // 8192
+constexpr int     SOFTCLIP_BITS  = 8;
+constexpr int     SOFTCLIP_LEN   = 1 << SOFTCLIP_BITS;
+constexpr int32_t SOFTCLIP_RANGE = 4 * SOFTCLIP_WIDTH;
+constexpr int     SOFTCLIP_SHIFT = 7;                      // log2(SOFTCLIP_RANGE / SOFTCLIP_LEN)
+static_assert((SOFTCLIP_RANGE >> SOFTCLIP_SHIFT) == SOFTCLIP_LEN, "Soft clip table step");
+
+extern const std::array<int16_t, SOFTCLIP_LEN + 1> SOFTCLIP_TABLE;
+
+// --- Lookahead Limiter ---
+// Gain is computed per chunk and the signal is delayed by one chunk, so the
+// gain is already down when a peak arrives. The delay is always in the path
+// (bypass = unity gain), so toggling the limiter never glitches.
+constexpr int     LIMITER_CHUNK = 32;                      // Lookahead (~0.7 ms)
+constexpr int32_t LIMITER_CEILING = 40960;                 // Peak into the soft clipper (1.25 FS)
+constexpr int32_t LIMITER_UNITY_Q12 = 4096;
+constexpr int32_t LIMITER_RELEASE_Q12 = 16;                // Max gain rise per chunk (~95 ms to recover 6 dB)
+constexpr int32_t LIMITER_INPUT_MAX = (1 << 19) - 1;       // Keeps (x * gain_q12) within 32 bits
+constexpr uint32_t OUTPUT_STAGE_DELAY_US = (uint32_t)((LIMITER_CHUNK * 1000000ULL) / FS_O);
+static_assert(O_BUFFER_SIZE % LIMITER_CHUNK == 0, "Blocks must hold whole limiter chunks");
+
+/**
+ * @brief Soft clip of one mixed sample into the 16-bit range.
+ * Samples below the knee pass through with one compare.
+ */
+static inline int32_t soft_clip(int32_t x) {
+    int32_t a = (x < 0) ? -x : x;
+    if (a <= SOFTCLIP_KNEE) return x;
+
+    int32_t over = a - SOFTCLIP_KNEE;
+    int32_t y;
+    if (over >= SOFTCLIP_RANGE) {
+        y = SOFTCLIP_TABLE[SOFTCLIP_LEN];
+    } else {
+        // Linear interpolation between table points
+        int32_t idx = over >> SOFTCLIP_SHIFT;
+        int32_t frac = over & ((1 << SOFTCLIP_SHIFT) - 1);
+        int32_t y0 = SOFTCLIP_TABLE[idx];
+        y = y0 + (((SOFTCLIP_TABLE[idx + 1] - y0) * frac) >> SOFTCLIP_SHIFT);
+    }
+    return (x < 0) ? -y : y;
+}
+
+/**
+ * @brief Enables the lookahead limiter (soft clipping is always on).
+ */
+void set_output_limiter(bool enable);
+
+/**
+ * @brief Limits and soft-clips a mixed block in place.
+ * Output is delayed by OUTPUT_STAGE_DELAY_US and within +/-32767.
+ * @param mix_buffer  Mix accumulator, replaced by the output samples
+ * @param num_samples Multiple of LIMITER_CHUNK
+ */
+void output_stage_process(int32_t *mix_buffer, uint num_samples);
+
+/**
+ * @brief Clears the lookahead delay and resets the gain to unity.
+ */
+void output_stage_reset();
+
+/**
+ * @brief Current limiter gain in Q12 (4096 = no reduction), for telemetry.
+ */
+int32_t output_limiter_gain();
+
+#endif // OUTPUT_STAGE_H
@@ -0,0 +1,67 @@
+/**
+ * File: phase_align.hpp
+ * Description: Steers a voice onto the measured string phase.
+ * Header-only and free of hardware access, so the render loop and the host
+ * simulation (tests/phase_align_sim.cpp) run the exact same code.
+ */
+
+#ifndef PHASE_ALIGN_H
+#define PHASE_ALIGN_H
+
+#include <stdint.h>
+#include <math.h>
+#include "macros.hpp" // FS_O, two32
+
+// --- Phase Alignment ---
+// Voices can be steered onto the measured string phase, so the exciter drives
+// the string coherently instead of at an arbitrary phase.
+// Loop latency: from a sample leaving the I2S to its force reaching the string
+// (PIO FIFO, DAC, amplifier, exciter). Calibrate per build with set_phase_alignment.
+constexpr uint32_t DEFAULT_LOOP_LATENCY_US = 1500;
+// Drive phase relative to the string's (sine convention): +90 deg puts the force
+// in phase with the string velocity, which maximizes the power delivered.
+constexpr uint32_t DEFAULT_PHASE_OFFSET = 0x40000000;
+constexpr int      PHASE_SLEW_SHIFT = 3;            // Remove 1/8 of the phase error per block
+constexpr int32_t  PHASE_MAX_SLEW = 0x08000000;     // At most 1/32 cycle per block (no audible FM)
+constexpr uint32_t PHASE_MAX_AGE_US = 500000;       // Don't extrapolate older measurements
+
+/**
+ * @brief Increment for one block that steers the voice toward the string
+ * phase predicted for when the block's first sample reaches the string.
+ * The phase is never set directly: the increment is trimmed so the error
+ * shrinks by 1/2^PHASE_SLEW_SHIFT over the block (a first-order PLL).
+ * @param string_freq_hz  Measured string frequency
+ * @param string_phase    String phase (DDS units, sine convention) at string_phase_us
+ * @param string_phase_us Time of that measurement
+ * @param voice_phase     Voice phase at the start of the block
+ * @param play_us         When the block's first sample leaves the I2S
+ * @param loop_latency_us I2S to string delay
+ * @param phase_offset    Drive phase relative to the string (DDS units)
+ * @param num_samples     Block length
+ * @param increment       Set to the new phase increment
+ * @return false (increment unchanged) if the measurement is too old or in the future
+ */
+static inline bool phase_align_increment(float string_freq_hz, uint32_t string_phase, uint32_t string_phase_us,
+                                         uint32_t voice_phase, uint32_t play_us, uint32_t loop_latency_us,
+                                         uint32_t phase_offset, unsigned num_samples, uint32_t *increment) {
+    // 1. Time from the measurement to when this block's first sample reaches the string
+    int32_t age_us = (int32_t)(play_us + loop_latency_us - string_phase_us);
+    if (age_us < 0 || (uint32_t)age_us > PHASE_MAX_AGE_US) return false;
+
+    // 2. String phase at that moment (extrapolated at the measured frequency)
+    float cycles = string_freq_hz * (float)age_us * 1e-6f;
+    cycles -= floorf(cycles);
+    uint32_t target = string_phase + (uint32_t)(int64_t)(cycles * (float)two32) + phase_offset;
+
+    // 3. Track the measured frequency, plus the phase correction spread over the block
+    int32_t error = (int32_t)(target - voice_phase);
+    int32_t correction = error >> PHASE_SLEW_SHIFT;
+    if (correction > PHASE_MAX_SLEW) correction = PHASE_MAX_SLEW;
+    else if (correction < -PHASE_MAX_SLEW) correction = -PHASE_MAX_SLEW;
+
+    uint32_t inc = (uint32_t)(string_freq_hz * (float)DDS_FACTOR);
+    *increment = inc + correction / (int32_t)num_samples;
+    return true;
+}
+
+#endif // PHASE_ALIGN_H
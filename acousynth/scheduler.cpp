@@ -0,0 +1,158 @@
+/**
+ * File: scheduler.cpp
+ * Description: Earliest-deadline-first task loop and idle accounting.
+ *
+ * No wakeup is lost between the last ready() check and the sleep: an
+ * interrupt taken in that gap sets the event register, so the __wfe()
+ * returns at once and the tasks are checked again.
+ */
+
+#include "scheduler.hpp"
+#include "pico/stdlib.h"
+#include <stdio.h>
+
+// --- Task Table ---
+static SchedTask tasks[SCHED_MAX_TASKS];
+static int num_tasks = 0;
+
+// --- Idle Accounting ---
+static uint32_t idle_us = 0;
+static uint32_t idle_total_us = 0;
+static uint32_t window_start_us = 0;
+static uint32_t wakeups = 0;
+
+// --- Helper Functions ---
+
+static int add_task(const char *name, TaskFn run, TaskReadyFn ready,
+                    uint32_t period_us, uint32_t deadline_us) {
+    if (num_tasks == SCHED_MAX_TASKS) {
+        printf("[Sched] Task table full, '%s' not added\n", name);
+        return -1;
+    }
+    SchedTask *t = &tasks[num_tasks];
+    t->name = name;
+    t->run = run;
+    t->ready = ready;
+    t->period_us = period_us;
+    t->deadline_us = deadline_us;
+    t->due_us = time_us_32() + period_us;
+    t->waiting = false;
+    t->runs = 0;
+    t->max_run_us = 0;
+    t->late = 0;
+    return num_tasks++;
+}
+
+// Due task with the earliest deadline, or NULL. Also returns how long the
+// core may sleep before the next periodic task is due.
+static SchedTask* pick_task(uint32_t now, uint32_t *sleep_us) {
+    SchedTask *best = NULL;
+    int32_t best_left = INT32_MAX;
+    uint32_t sleep = SCHED_MAX_SLEEP_US;
+
+    for (int i = 0; i < num_tasks; i++) {
+        SchedTask *t = &tasks[i];
+        if (t->ready) {
+            // Event task: due from the first pass that saw it ready
+            if (!t->ready()) {
+                t->waiting = false;
+                continue;
+            }
+            if (!t->waiting) {
+                t->waiting = true;
+                t->due_us = now;
+            }
+        } else {
+            int32_t until_due = (int32_t)(t->due_us - now);
+            if (until_due > 0) {
+                if ((uint32_t)until_due < sleep) sleep = (uint32_t)until_due;
+                continue;
+            }
+        }
+
+        // Time left to this task's deadline (ties go to the earlier task)
+        int32_t left = (int32_t)(t->due_us + t->deadline_us - now);
+        if (left < best_left) {
+            best_left = left;
+            best = t;
+        }
+    }
+    *sleep_us = sleep;
+    return best;
+}
+
+static void run_task(SchedTask *t, uint32_t now) {
+    if ((int32_t)(t->due_us + t->deadline_us - now) < 0) t->late++;
+
+    t->run();
+
+    uint32_t elapsed = time_us_32() - now;
+    if (elapsed > t->max_run_us) t->max_run_us = elapsed;
+    t->runs++;
+
+    if (t->ready) {
+        t->waiting = false;
+    } else {
+        // Keep the period; after a long stall, skip the missed runs
+        t->due_us += t->period_us;
+        if ((int32_t)(t->due_us - time_us_32()) < 0) t->due_us = time_us_32() + t->period_us;
+    }
+}
+
+// --- Public Functions ---
+
+int sched_add_periodic(const char *name, TaskFn run, uint32_t period_us, uint32_t deadline_us) {
+    return add_task(name, run, NULL, period_us, deadline_us);
+}
+
+int sched_add_event(const char *name, TaskFn run, TaskReadyFn ready, uint32_t deadline_us) {
+    return add_task(name, run, ready, 0, deadline_us);
+}
+
+void sched_run() {
+    printf("[Sched] Running %d tasks\n", num_tasks);
+    window_start_us = time_us_32();
+
+    while (true) {
+        uint32_t now = time_us_32();
+        uint32_t sleep_us;
+        SchedTask *t = pick_task(now, &sleep_us);
+
+        if (t) {
+            run_task(t, now);
+            continue;
+        }
+
+        // Nothing due: sleep until the next periodic task or an interrupt
+        best_effort_wfe_or_timeout(make_timeout_time_us(sleep_us));
+        uint32_t slept = time_us_32() - now;
+        idle_us += slept;
+        idle_total_us += slept;
+        wakeups++;
+    }
+}
+
+uint32_t sched_idle_pct() {
+    uint32_t now = time_us_32();
+    uint32_t window_us = now - window_start_us;
+    uint32_t pct = (window_us > 0) ? (uint32_t)((uint64_t)idle_us * 100 / window_us) : 0;
+    idle_us = 0;
+    wakeups = 0;
+    window_start_us = now;
+    return pct;
+}
+
+uint32_t sched_idle_us() {
+    return idle_total_us;
+}
+
+void print_sched_stats() {
+    uint32_t window_wakeups = wakeups;
+    uint32_t idle = sched_idle_pct();
+    printf("[Sched] Idle %lu%%, Wakeups %lu\n", (unsigned long)idle, (unsigned long)window_wakeups);
+    for (int i = 0; i < num_tasks; i++) {
+        const SchedTask *t = &tasks[i];
+        printf("[Sched]   %-10s runs %lu, max %lu us, late %lu\n", t->name,
+               (unsigned long)t->runs, (unsigned long)t->max_run_us, (unsigned long)t->late);
+    }
+}
@@ -0,0 +1,74 @@
+/**
+ * File: scheduler.hpp
+ * Description: Deadline-ordered cooperative task loop with WFE idle.
+ *
+ * Tasks are either periodic (due every period_us) or event tasks (due while
+ * their ready() check returns true: a completed DMA block, a free audio
+ * buffer...). Each due task gets an absolute deadline: its due time plus its
+ * relative deadline_us. The loop always runs the due task with the earliest
+ * deadline, one call at a time; tasks keep their work short (one block, one
+ * analysis slice) so a more urgent task never waits long.
+ * With nothing due, the core sleeps in __wfe() until the next periodic task
+ * or any interrupt (DMA, I2S, USB) wakes it, and the sleep is counted as idle.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+constexpr int SCHED_MAX_TASKS = 8;
+constexpr uint32_t SCHED_MAX_SLEEP_US = 100000; // Longest single idle sleep
+
+typedef void (*TaskFn)();
+typedef bool (*TaskReadyFn)();
+
+typedef struct SchedTask {
+    const char *name;
+    TaskFn run;
+    TaskReadyFn ready;          // Event task: has work now (NULL for periodic tasks)
+    uint32_t period_us;         // Periodic task: interval between runs
+    uint32_t deadline_us;       // Allowed delay once due
+    uint32_t due_us;            // Periodic: next due time; event: first seen ready
+    bool waiting;               // Event task was seen ready and has not run since
+    uint32_t runs;              // Calls since boot
+    uint32_t max_run_us;        // Longest call since boot
+    uint32_t late;              // Calls started after their deadline
+} SchedTask;
+
+/**
+ * @brief Adds a task run every period_us (first run one period from now).
+ * @return Task index, or -1 if the table is full
+ */
+int sched_add_periodic(const char *name, TaskFn run, uint32_t period_us, uint32_t deadline_us);
+
+/**
+ * @brief Adds a task run whenever ready() returns true. ready() is called
+ * on every pass of the loop, so it must be a cheap check (a flag or counter).
+ * @return Task index, or -1 if the table is full
+ */
+int sched_add_event(const char *name, TaskFn run, TaskReadyFn ready, uint32_t deadline_us);
+
+/**
+ * @brief Runs the task loop on the calling core. Never returns.
+ */
+void sched_run();
+
+/**
+ * @brief Share of time spent asleep since the last call, in percent
+ * (starts a new measurement window).
+ */
+uint32_t sched_idle_pct();
+
+/**
+ * @brief Total time spent asleep since boot (wraps), for callers keeping
+ * their own measurement window.
+ */
+uint32_t sched_idle_us();
+
+/**
+ * @brief Prints idle time and per-task counters, and starts a new idle window.
+ */
+void print_sched_stats();
+
+#endif // SCHEDULER_H
@@ -0,0 +1,58 @@
+/**
+ * File: usb_capture.cpp
+ * Description: Framed raw ADC streaming over the USB stdio CDC port.
+ *
+ * The frame goes to the stdio USB driver directly (stdio_usb.out_chars),
+ * which bypasses the CR/LF translation of printf. Each write takes the same
+ * lock as printf; a printf landing between the header and the samples
+ * breaks that one frame, which the host catches by its checksum.
+ */
+
+#include "usb_capture.hpp"
+#include "pico/stdio_usb.h"
+#include "tusb.h"
+
+// --- Capture State ---
+static bool capture_enabled = false;
+static CaptureStats capture_stats;
+
+// --- Public Functions ---
+
+void set_usb_capture(bool enable) {
+    capture_enabled = enable;
+    printf("[Capture] USB capture %s (%lu bytes per frame)\n",
+           enable ? "on" : "off", (unsigned long)CAPTURE_FRAME_BYTES);
+}
+
+void usb_capture_block(const InputBlock *block) {
+    if (!capture_enabled || !stdio_usb_connected()) return;
+
+    // 1. Never wait on the host: the whole frame fits or it is dropped
+    if (tud_cdc_write_available() < CAPTURE_FRAME_BYTES) {
+        capture_stats.dropped++;
+        return;
+    }
+
+    // 2. Header
+    uint16_t sum = 0;
+    for (int i = 0; i < HOP_SIZE; i++) {
+        sum = (uint16_t)(sum + (uint16_t)block->samples[i]);
+    }
+    CaptureHeader header;
+    header.magic = CAPTURE_MAGIC;
+    header.seq = block->seq;
+    header.capture_us = block->capture_us;
+    header.fs_hz = FS_I;
+    header.num_samples = HOP_SIZE;
+    header.checksum = sum;
+    header.flags = 0;
+
+    // 3. Header, then the samples straight from the DMA block
+    stdio_usb.out_chars((const char *)&header, sizeof(header));
+    stdio_usb.out_chars((const char *)block->samples, HOP_SIZE * sizeof(int16_t));
+    capture_stats.frames++;
+}
+
+const CaptureStats* get_capture_stats() {
+    return &capture_stats;
+}
@@ -0,0 +1,58 @@
+/**
+ * File: usb_capture.hpp
+ * Description: Raw ADC capture over USB for offline analysis tuning.
+ *
+ * Each input block the analysis takes is sent over the USB CDC port as one
+ * frame: a CaptureHeader followed by the block's HOP_SIZE raw 12-bit
+ * samples, sent straight from the DMA block (no staging copy). Sending never
+ * waits: if the USB FIFO has no room for a whole frame, the frame is dropped
+ * and counted, and the gap shows up in the sequence numbers.
+ * Text written by printf shares the port; the host tool (tools/acap_to_wav.py)
+ * resynchronises on CAPTURE_MAGIC and rejects frames failing the checksum.
+ */
+
+#ifndef USB_CAPTURE_H
+#define USB_CAPTURE_H
+
+#include <stdint.h>
+#include "input_config.hpp"
+
+constexpr uint32_t CAPTURE_MAGIC = 0x50414341;  // "ACAP" (little-endian)
+
+// --- Frame Header (little-endian, 20 bytes) ---
+typedef struct __attribute__((packed)) CaptureHeader {
+    uint32_t magic;             // CAPTURE_MAGIC
+    uint32_t seq;               // InputBlock::seq
+    uint32_t capture_us;        // InputBlock::capture_us
+    uint16_t fs_hz;             // Input sample rate (FS_I)
+    uint16_t num_samples;       // Samples following the header (HOP_SIZE)
+    uint16_t checksum;          // Sum of the samples, mod 2^16
+    uint16_t flags;             // Reserved (0)
+} CaptureHeader;
+static_assert(sizeof(CaptureHeader) == 20, "Capture header is sent as is");
+
+constexpr uint32_t CAPTURE_FRAME_BYTES = sizeof(CaptureHeader) + HOP_SIZE * sizeof(int16_t);
+
+typedef struct CaptureStats {
+    uint32_t frames;            // Frames sent
+    uint32_t dropped;           // Frames dropped (host not reading, FIFO full)
+} CaptureStats;
+
+/**
+ * @brief Starts or stops streaming input blocks.
+ * Frames are only sent while a host has the port open.
+ */
+void set_usb_capture(bool enable);
+
+/**
+ * @brief Sends one input block. Call before the block is released.
+ * Returns immediately if capture is off or there is no room for the frame.
+ */
+void usb_capture_block(const InputBlock *block);
+
+/**
+ * @brief Returns the capture counters.
+ */
+const CaptureStats* get_capture_stats();
+
+#endif // USB_CAPTURE_H
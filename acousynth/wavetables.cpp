@@ -5,99 +5,437 @@
 
 #include "wavetables.hpp"
 #include "macros.hpp" // Ensure WAVETABLE_LEN and TWO_PI are here
+#include "hardware/sync.h" // __dmb
 #include <math.h>
 #include <stdio.h>
 #include <string.h>   // for memset
+#include "const_math.hpp"
+#include "libs/kissfft/kiss_fftr.h"
 
-// --- 1. STATIC MEMORY ALLOCATION ---
-// We allocate these in BSS (RAM) to avoid Heap fragmentation.
-// These hold the "Source" data.
-int16_t SINE_TABLE[WAVETABLE_LEN];
-int16_t SAW_TABLE[WAVETABLE_LEN];
-int16_t SQUARE_TABLE[WAVETABLE_LEN];
-int16_t TRI_TABLE[WAVETABLE_LEN];
+// --- Constants ---
+// Band-limiting a saw/square overshoots by ~9% of the jump (Gibbs), i.e. up to
+// ~18% of full scale for a full-range jump; scale every level back into range.
+// A pure sine has no overshoot and keeps full scale, the same level as the
+// recursive oscillator and the IFFT engine.
+constexpr float MIP_GIBBS_HEADROOM = 0.84f;
+constexpr int   MIP_NUM_BINS = WAVETABLE_LEN / 2 + 1;
+constexpr int   MIX_SLICE_LEN = 128;   // Table samples mixed per background slice
 
-// This holds the "Destination" (Mixed) data that the DMA reads.
-int16_t SYNTH_TABLE[WAVETABLE_LEN];
+// --- 1. BASE TABLES ---
+// Computed by the compiler; 'const' places them in flash (.rodata), not SRAM.
+// These hold the "Source" data and are only read by the mixer. The exception
+// is the quarter-wave sine: sine_lookup() is on the audio path, so it is a
+// RAM_TABLE (copied from flash to SRAM at boot).
+
+// Sine: quarter wave, sin(0..pi/2) inclusive of both ends, folded by symmetry.
+static constexpr std::array<int16_t, SINE_QUARTER_LEN + 1> make_sine_quarter() {
+    std::array<int16_t, SINE_QUARTER_LEN + 1> t{};
+    for (int i = 0; i <= SINE_QUARTER_LEN; i++) {
+        t[i] = ce_to_q15(ce_sin(TWO_PI * i / WAVETABLE_LEN));
+    }
+    return t;
+}
+
+// Sawtooth Wave (Ramp Down): goes from 1.0 to -1.0
+static constexpr std::array<int16_t, WAVETABLE_LEN> make_saw() {
+    std::array<int16_t, WAVETABLE_LEN> t{};
+    for (int i = 0; i < WAVETABLE_LEN; i++) {
+        t[i] = ce_to_q15(1.0 - (2.0 * i / WAVETABLE_LEN));
+    }
+    return t;
+}
+
+// Square Wave (50% Duty Cycle): high for first half, low for second half
+static constexpr std::array<int16_t, WAVETABLE_LEN> make_square() {
+    std::array<int16_t, WAVETABLE_LEN> t{};
+    for (int i = 0; i < WAVETABLE_LEN; i++) {
+        t[i] = (i < WAVETABLE_LEN / 2) ? 32767 : -32767;
+    }
+    return t;
+}
+
+// Triangle Wave: rises to 1.0, falls to -1.0
+static constexpr std::array<int16_t, WAVETABLE_LEN> make_tri() {
+    std::array<int16_t, WAVETABLE_LEN> t{};
+    for (int i = 0; i < WAVETABLE_LEN; i++) {
+        double phase = (double)i / WAVETABLE_LEN;
+        t[i] = ce_to_q15(phase < 0.5 ? -1.0 + 4.0 * phase   // Rise
+                                     :  3.0 - 4.0 * phase); // Fall
+    }
+    return t;
+}
+
+constexpr std::array<int16_t, SINE_QUARTER_LEN + 1> RAM_TABLE("sine_quarter") SINE_QUARTER_TABLE = make_sine_quarter();
+static constexpr std::array<int16_t, WAVETABLE_LEN> SAW_TABLE = make_saw();
+static constexpr std::array<int16_t, WAVETABLE_LEN> SQUARE_TABLE = make_square();
+static constexpr std::array<int16_t, WAVETABLE_LEN> TRI_TABLE = make_tri();
+
+// --- 2. SRAM TABLES ---
+// This holds the "Destination" (Mixed) data that the DMA reads,
+// one band-limited copy per octave (mip level). Double-buffered: the synth
+// reads the active bank while the next timbre is built into the other one.
+int16_t SYNTH_TABLE[2][WAVETABLE_MIP_LEVELS][WAVETABLE_LEN];
+static bool bank_is_sine[2] = { true, true };
+static TimbreHarmonics bank_harmonics[2];
+static volatile int active_bank = 0;
+
+// Mip generation scratch (FFT of the mixed table)
+static kiss_fftr_cfg mip_fft_cfg;
+static kiss_fftr_cfg mip_ifft_cfg;
+static float mip_time[WAVETABLE_LEN];
+static kiss_fft_cpx mip_spectrum[MIP_NUM_BINS];
 
 // Pointer exposed to main.cpp
-int16_t *current_wave_table = SINE_TABLE; 
+int16_t *current_wave_table = SYNTH_TABLE[0][0]; 
+bool synth_table_is_sine = true;
+const TimbreHarmonics *current_harmonics = &bank_harmonics[0];
+
+// Crossfade state (owned by the synth, advanced at block boundaries)
+int16_t *previous_wave_table = NULL;
+const TimbreHarmonics *previous_harmonics = NULL;
+int32_t wavetable_xfade_q24 = XFADE_ONE_Q24;
+int32_t wavetable_xfade_step = 0;
+static int xfade_blocks = SYNTH_XFADE_BLOCKS;
+static volatile int xfade_blocks_left = 0; // Written by the synthesis, read by the builder
+static uint xfade_last_samples = 0;        // Length of the block the current step was set for
+
+// --- Background Builder State ---
+typedef enum {
+    BUILD_IDLE,
+    BUILD_MIX,      // Mix WAVETABLE_LEN samples, MIX_SLICE_LEN per slice
+    BUILD_FFT,      // Forward FFT of the naive mix
+    BUILD_SPECTRUM, // Spectrum from a captured harmonic profile
+    BUILD_MIPS,     // One band-limited level (one IFFT) per slice
+} Build_Stage;
 
-// --- 2. GENERATION LOGIC ---
+static Build_Stage build_stage = BUILD_IDLE;
+static int build_pos = 0;           // Sample (MIX) or level (MIPS) cursor
+static int build_kept = 0;          // Highest harmonic still in mip_spectrum
+static int build_bank = 1;
+static bool build_requested = false;
+static bool req_is_profile = false; // Request is a harmonic profile, not a mix
+static float req_weights[4];        // Latest requested Sine, Saw, Square, Triangle
+static float req_harmonics[MAX_TIMBRE_HARMONICS];
+static int req_num_harmonics = 0;
+static float build_harmonics[MAX_TIMBRE_HARMONICS];
+static int build_num_harmonics = 0;
+static float build_weights[4];      // Normalized weights of the build in progress
+static volatile bool swap_pending = false;
+
+// --- 3. INITIALIZATION ---
 void init_wavetables() {
-    printf("[Wavetables] Generating Base Tables (Len: %d)...\n", WAVETABLE_LEN);
+    printf("[Wavetables] Base Tables in flash, quarter-wave Sine in SRAM (Len: %d)\n", WAVETABLE_LEN);
 
-    for (int i = 0; i < WAVETABLE_LEN; i++) {
-        // A. Sine Wave (Standard)
-        // sin(0..2PI) -> -1.0 to 1.0
-        float v_sine = sinf((float)TWO_PI * i / WAVETABLE_LEN);
-        SINE_TABLE[i] = (int16_t)(v_sine * 32767.0f);
-
-        // B. Sawtooth Wave (Ramp Down)
-        // Goes from 1.0 to -1.0
-        float v_saw = 1.0f - (2.0f * (float)i / (float)WAVETABLE_LEN);
-        SAW_TABLE[i] = (int16_t)(v_saw * 32767.0f);
-
-        // C. Square Wave (50% Duty Cycle)
-        // High for first half, Low for second half
-        if (i < WAVETABLE_LEN / 2) {
-            SQUARE_TABLE[i] = 32767;
-        } else {
-            SQUARE_TABLE[i] = -32767;
+    // Start on a pure sine, copied straight from the quarter-wave table into
+    // every level of bank 0: a sine is band-limited at every level, so it
+    // needs no FFT (and no Gibbs headroom)
+    for (int level = 0; level < WAVETABLE_MIP_LEVELS; level++) {
+        for (int i = 0; i < WAVETABLE_LEN; i++) {
+            SYNTH_TABLE[0][level][i] = sine_lookup(i);
         }
+    }
+    active_bank = 0;
+    bank_is_sine[0] = true;
+    current_wave_table = SYNTH_TABLE[0][0];
+    synth_table_is_sine = true;
 
-        // D. Triangle Wave
-        // Rises to 1.0, falls to -1.0
-        float phase = (float)i / (float)WAVETABLE_LEN;
-        float v_tri = 0.0f;
-        if (phase < 0.5f) {
-            v_tri = -1.0f + (4.0f * phase); // Rise
-        } else {
-            v_tri = 3.0f - (4.0f * phase);  // Fall
-        }
-        TRI_TABLE[i] = (int16_t)(v_tri * 32767.0f);
+    // A sine is its fundamental alone: c_0 = -j
+    memset(&bank_harmonics[0], 0, sizeof(TimbreHarmonics));
+    bank_harmonics[0].im[0] = -1.0f;
+    bank_harmonics[0].count = 1;
+    current_harmonics = &bank_harmonics[0];
+}
+
+// --- 4. BUILD SLICES ---
+
+// Level scale of the bank being built: no Gibbs headroom for a pure sine
+static inline float build_headroom() {
+    return bank_is_sine[build_bank] ? 1.0f : MIP_GIBBS_HEADROOM;
+}
+
+// Keeps the leading harmonics of the spectrum for the IFFT engine, scaled the
+// way build_mip_slice() scales level 0 (kiss_fftri: x[n] = sum X[k] e^(+j2pi kn/N))
+static void capture_harmonics() {
+    TimbreHarmonics *t = &bank_harmonics[build_bank];
+    float scale = 2.0f * build_headroom() / ((float)WAVETABLE_LEN * 32767.0f);
+    t->count = 0;
+    for (int h = 0; h < TIMBRE_PARTIAL_HARMONICS; h++) {
+        t->re[h] = mip_spectrum[h + 1].r * scale;
+        t->im[h] = mip_spectrum[h + 1].i * scale;
+        if (fabsf(t->re[h]) + fabsf(t->im[h]) > 1e-4f) t->count = h + 1;
     }
-    
-    // Set default to pure sine to start
-    set_synth_table(1.0f, 0.0f, 0.0f, 0.0f);
 }
 
-// --- 3. ADDITIVE SYNTHESIS MIXER ---
-// Mixes the 4 base tables into SYNTH_TABLE with normalization.
-void set_synth_table(float w_sine, float w_saw, float w_square, float w_tri) {
-    
+// Mixes the 4 base tables into level 0 of the shadow bank, one slice at a time
+static void build_mix_slice() {
+    int16_t *dst = SYNTH_TABLE[build_bank][0];
+    int end = build_pos + MIX_SLICE_LEN;
+
+    for (int i = build_pos; i < end; i++) {
+        // Weighted Sum (using floats for precision), already normalized
+        float mixed_sample = (sine_lookup(i)   * build_weights[0]) +
+                             (SAW_TABLE[i]     * build_weights[1]) +
+                             (SQUARE_TABLE[i]  * build_weights[2]) +
+                             (TRI_TABLE[i]     * build_weights[3]);
+
+        // Store in Destination Table
+        dst[i] = (int16_t)mixed_sample;
+    }
+
+    build_pos = end;
+    if (build_pos >= WAVETABLE_LEN) build_stage = BUILD_FFT;
+}
+
+// Spectrum of the naive mixed table
+static void build_fft_slice() {
+    const int16_t *src = SYNTH_TABLE[build_bank][0];
+    for (int i = 0; i < WAVETABLE_LEN; i++) {
+        mip_time[i] = (float)src[i];
+    }
+    kiss_fftr(mip_fft_cfg, mip_time, mip_spectrum);
+
+    // Remove DC; the levels then truncate harmonics (fewest kept last)
+    mip_spectrum[0].r = 0.0f;
+    mip_spectrum[0].i = 0.0f;
+    capture_harmonics();
+    build_kept = MIP_NUM_BINS - 1;
+    build_pos = 0;
+    build_stage = BUILD_MIPS;
+}
+
+// Spectrum of a captured timbre: harmonic h+1 as a sine of amplitude amps[h].
+// Scaled so the amplitudes sum to full scale after the mip stage's headroom.
+static void build_spectrum_slice() {
+    memset(mip_spectrum, 0, sizeof(mip_spectrum));
+
+    float total = 0.0f;
+    for (int h = 0; h < build_num_harmonics; h++) total += build_harmonics[h];
+    if (total < 0.0001f) {
+        // Silent profile: fall back to the fundamental alone
+        build_harmonics[0] = 1.0f;
+        build_num_harmonics = 1;
+        total = 1.0f;
+    }
+
+    // kiss_fftri: x[n] = sum X[k] e^(+j2pi kn/N), so sin needs X[k] = -j * A * N/2
+    float scale = 32767.0f * (float)WAVETABLE_LEN / (2.0f * build_headroom() * total);
+    for (int h = 0; h < build_num_harmonics && h + 1 < MIP_NUM_BINS - 1; h++) {
+        mip_spectrum[h + 1].i = -build_harmonics[h] * scale;
+    }
+    capture_harmonics();
+
+    build_kept = MIP_NUM_BINS - 1;
+    build_pos = 0;
+    build_stage = BUILD_MIPS;
+}
+
+// Level L keeps harmonics 1..(WAVETABLE_LEN/2 >> L), so at the highest increment
+// that selects it (2^(PHASE_SHIFT + L)) its top harmonic sits just below Nyquist.
+static void build_mip_slice() {
+    int level = build_pos;
+    int max_harmonic = (WAVETABLE_LEN / 2) >> level;
+    if (max_harmonic >= MIP_NUM_BINS - 1) max_harmonic = MIP_NUM_BINS - 2; // Drop the table's Nyquist bin
+    for (int k = max_harmonic + 1; k <= build_kept; k++) {
+        mip_spectrum[k].r = 0.0f;
+        mip_spectrum[k].i = 0.0f;
+    }
+    build_kept = max_harmonic;
+
+    kiss_fftri(mip_ifft_cfg, mip_spectrum, mip_time);
+
+    float scale = build_headroom() / (float)WAVETABLE_LEN; // kiss_fftri is unnormalized
+    int16_t *dst = SYNTH_TABLE[build_bank][level];
+    for (int i = 0; i < WAVETABLE_LEN; i++) {
+        float v = mip_time[i] * scale;
+        if (v > 32767.0f) v = 32767.0f;
+        else if (v < -32767.0f) v = -32767.0f;
+        dst[i] = (int16_t)v;
+    }
+
+    build_pos++;
+    if (build_pos >= WAVETABLE_MIP_LEVELS) {
+        // Hand the finished bank to the synth; it swaps at the next block boundary.
+        // The barrier keeps the table writes ahead of the flag (the synth may be on the other core).
+        build_stage = BUILD_IDLE;
+        __dmb();
+        swap_pending = true;
+    }
+}
+
+// Starts building the latest request, once the shadow bank is no longer read
+static bool start_build() {
+    if (!build_requested || swap_pending || xfade_blocks_left > 0) return false;
+
+    // FFT plans on first use, off the boot path (kissfft computes its twiddles in soft-float)
+    if (!mip_fft_cfg) {
+        mip_fft_cfg = kiss_fftr_alloc(WAVETABLE_LEN, 0, NULL, NULL);
+        mip_ifft_cfg = kiss_fftr_alloc(WAVETABLE_LEN, 1, NULL, NULL);
+    }
+
+    build_bank = active_bank ^ 1;
+    build_requested = false;
+    build_pos = 0;
+
+    if (req_is_profile) {
+        bool is_sine = true;
+        for (int h = 0; h < req_num_harmonics; h++) {
+            build_harmonics[h] = req_harmonics[h];
+            if (h > 0 && req_harmonics[h] > 0.0f) is_sine = false;
+        }
+        build_num_harmonics = req_num_harmonics;
+        bank_is_sine[build_bank] = is_sine;
+        build_stage = BUILD_SPECTRUM;
+        return true;
+    }
+
     // 1. Calculate Total Weight for Normalization
     // We must normalize to prevent clipping (overflowing int16).
-    float total_weight = w_sine + w_saw + w_square + w_tri;
+    float total_weight = req_weights[0] + req_weights[1] + req_weights[2] + req_weights[3];
     
     // Safety: Prevent divide by zero if user sends all 0.0s
     if (total_weight < 0.0001f) {
         total_weight = 1.0f; 
-        // Optional: Could zero out table here, but let's keep logic simple
     }
 
     float normalization_factor = 1.0f / total_weight;
+    for (int w = 0; w < 4; w++) {
+        build_weights[w] = req_weights[w] * normalization_factor;
+    }
 
-    // 2. Additive Mixing Loop
-    for (int i = 0; i < WAVETABLE_LEN; i++) {
-        // Weighted Sum (using floats for precision)
-        float mixed_sample = (SINE_TABLE[i]   * w_sine) +
-                             (SAW_TABLE[i]    * w_saw)  +
-                             (SQUARE_TABLE[i] * w_square) +
-                             (TRI_TABLE[i]    * w_tri);
-        
-        // Normalize back to range
-        mixed_sample *= normalization_factor;
+    bank_is_sine[build_bank] = (req_weights[0] > 0.0f) && (req_weights[1] == 0.0f) &&
+                               (req_weights[2] == 0.0f) && (req_weights[3] == 0.0f);
+    build_stage = BUILD_MIX;
+    return true;
+}
 
-        // Store in Destination Table
-        SYNTH_TABLE[i] = (int16_t)mixed_sample;
+// --- 5. ADDITIVE SYNTHESIS MIXER ---
+// Queues a new mix of the 4 base tables; service_synth_table() builds it.
+void set_synth_table(float w_sine, float w_saw, float w_square, float w_tri) {
+    req_weights[0] = w_sine;
+    req_weights[1] = w_saw;
+    req_weights[2] = w_square;
+    req_weights[3] = w_tri;
+    req_is_profile = false;
+    build_requested = true;
+
+    // A newer request supersedes a build still in progress
+    if (build_stage != BUILD_IDLE) build_stage = BUILD_IDLE;
+}
+
+// Queues a table built from a captured harmonic profile
+void set_synth_table_harmonics(const float *harmonic_amps, int num_harmonics) {
+    if (num_harmonics > MAX_TIMBRE_HARMONICS) num_harmonics = MAX_TIMBRE_HARMONICS;
+    if (num_harmonics < 0) num_harmonics = 0;
+
+    for (int h = 0; h < num_harmonics; h++) {
+        req_harmonics[h] = (harmonic_amps[h] > 0.0f) ? harmonic_amps[h] : 0.0f;
+    }
+    req_num_harmonics = num_harmonics;
+    req_is_profile = true;
+    build_requested = true;
+
+    if (build_stage != BUILD_IDLE) build_stage = BUILD_IDLE;
+}
+
+bool service_synth_table() {
+    if (build_stage == BUILD_IDLE && !start_build()) {
+        return build_requested || swap_pending;
+    }
+
+    switch (build_stage) {
+        case BUILD_MIX:      build_mix_slice(); break;
+        case BUILD_FFT:      build_fft_slice(); break;
+        case BUILD_SPECTRUM: build_spectrum_slice(); break;
+        case BUILD_MIPS:     build_mip_slice(); break;
+        default: break;
     }
+    return true;
+}
+
+bool synth_table_build_ready() {
+    return build_stage != BUILD_IDLE
+        || (build_requested && !swap_pending && xfade_blocks_left == 0);
+}
+
+// Ends a running crossfade and swaps in a finished bank immediately, so the
+// shadow bank is free for the next build (flush only: the synth isn't running)
+static void finish_swap_now() {
+    previous_wave_table = NULL;
+    previous_harmonics = NULL;
+    wavetable_xfade_q24 = XFADE_ONE_Q24;
+    wavetable_xfade_step = 0;
+    xfade_blocks_left = 0;
+    if (swap_pending) {
+        active_bank ^= 1;
+        current_wave_table = SYNTH_TABLE[active_bank][0];
+        synth_table_is_sine = bank_is_sine[active_bank];
+        current_harmonics = &bank_harmonics[active_bank];
+        swap_pending = false;
+    }
+}
 
-    // 3. Point the engine to the new mixed table
-    current_wave_table = SYNTH_TABLE;
+void flush_synth_table() {
+    // start_build() waits for the block boundary to take the last bank; with
+    // no audio running that never comes, so take it here before each slice
+    do {
+        finish_swap_now();
+        if (build_requested || build_stage != BUILD_IDLE) service_synth_table();
+    } while (build_requested || build_stage != BUILD_IDLE || swap_pending);
 }
 
-void set_synth_env(int16_t *attack_time, int16_t *release_time) {
-    *attack_time = 30;   // ms
-    *release_time = 100; // ms
-}
\ No newline at end of file
+WavetableMemory get_wavetable_memory() {
+    // kissfft reports a plan's size without allocating when given a length and no buffer
+    size_t fft_len = 0, ifft_len = 0;
+    kiss_fftr_alloc(WAVETABLE_LEN, 0, NULL, &fft_len);
+    kiss_fftr_alloc(WAVETABLE_LEN, 1, NULL, &ifft_len);
+
+    WavetableMemory m;
+    m.synth_banks = sizeof(SYNTH_TABLE);
+    m.sine_quarter = sizeof(SINE_QUARTER_TABLE);
+    m.build_scratch = sizeof(mip_time) + sizeof(mip_spectrum) + sizeof(bank_harmonics);
+    m.fft_plans = (uint32_t)(fft_len + ifft_len);
+    return m;
+}
+
+void set_synth_xfade_blocks(int blocks) {
+    xfade_blocks = (blocks < 0) ? 0 : blocks;
+}
+
+// --- 6. BLOCK BOUNDARY (Synth Side) ---
+void __not_in_flash_func(wavetable_block_boundary)(uint num_samples) {
+    // 1. Advance a running crossfade by the block just played
+    if (xfade_blocks_left > 0) {
+        wavetable_xfade_q24 += wavetable_xfade_step * (int32_t)xfade_last_samples;
+        if (--xfade_blocks_left == 0) {
+            previous_wave_table = NULL;
+            previous_harmonics = NULL;
+            wavetable_xfade_q24 = XFADE_ONE_Q24;
+            wavetable_xfade_step = 0;
+        } else {
+            // Block lengths can change mid-fade: re-aim at 1.0 over the blocks left
+            int32_t remaining = XFADE_ONE_Q24 - wavetable_xfade_q24;
+            int32_t total = xfade_blocks_left * (int32_t)num_samples;
+            wavetable_xfade_step = (remaining > 0) ? (remaining + total - 1) / total : 0;
+        }
+    }
+
+    // 2. Atomic swap to a finished bank
+    if (swap_pending) {
+        int next = active_bank ^ 1;
+        if (xfade_blocks > 0) {
+            // Linear ramp over the whole crossfade, rounded up so it ends at >= 1.0
+            int32_t total = xfade_blocks * (int32_t)num_samples;
+            previous_wave_table = current_wave_table;
+            previous_harmonics = current_harmonics;
+            wavetable_xfade_q24 = 0;
+            wavetable_xfade_step = (XFADE_ONE_Q24 + total - 1) / total;
+            xfade_blocks_left = xfade_blocks;
+        }
+        current_wave_table = SYNTH_TABLE[next][0];
+        current_harmonics = &bank_harmonics[next];
+        synth_table_is_sine = bank_is_sine[next];
+        active_bank = next;
+        swap_pending = false;
+    }
+    xfade_last_samples = num_samples;
+}
@@ -5,21 +5,104 @@
 #include <math.h>
 #include "pico/stdlib.h"
 #include "macros.hpp" 
+#include <array>
+
+constexpr int SINE_QUARTER_LEN = WAVETABLE_LEN / 4;
+
+// --- 0. Quarter-Wave Sine ---
+// Quarter wave sin(0..pi/2) in Q15, SINE_QUARTER_LEN + 1 entries (both ends).
+// Computed by the compiler and copied to SRAM at boot (RAM_TABLE): it is read
+// per sample by sine_lookup().
+extern const std::array<int16_t, SINE_QUARTER_LEN + 1> SINE_QUARTER_TABLE;
+
+/**
+ * @brief Full-cycle sine lookup folded from the quarter-wave table.
+ * @param index Table index, 0..WAVETABLE_LEN-1 (higher bits are ignored)
+ */
+static inline int16_t sine_lookup(uint32_t index) {
+    uint32_t i = index & (SINE_QUARTER_LEN - 1);
+    switch ((index >> (WAVETABLE_BITS - 2)) & 3) {
+        case 0:  return  SINE_QUARTER_TABLE[i];                    // Rising
+        case 1:  return  SINE_QUARTER_TABLE[SINE_QUARTER_LEN - i]; // Falling (mirror)
+        case 2:  return -SINE_QUARTER_TABLE[i];                    // Negative half
+        default: return -SINE_QUARTER_TABLE[SINE_QUARTER_LEN - i];
+    }
+}
 
 // --- 1. Global Wavetable Pointer ---
 // The DMA reads from this pointer. We just change where it points.
+// It points at mip level 0; level L follows at current_wave_table + L * WAVETABLE_LEN.
 extern int16_t *current_wave_table;
 
-// --- 2. Function Prototypes ---
+// True when the mixer weights are pure sine: the synth can then use the
+// recursive oscillator instead of the table lookup.
+extern bool synth_table_is_sine;
+
+// Most harmonics a captured timbre can carry (fundamental included)
+constexpr int MAX_TIMBRE_HARMONICS = 16;
+
+// Leading harmonics of a synth table, for the IFFT engine (ifft_synth.hpp).
+// Complex coefficients in full-scale units, level 0 headroom included:
+// table(phase) ~= 32767 * sum_h Re(c_h * e^(j*(h+1)*phase)). A sine is c_0 = -j.
+constexpr int TIMBRE_PARTIAL_HARMONICS = 8;
+typedef struct {
+    float re[TIMBRE_PARTIAL_HARMONICS];
+    float im[TIMBRE_PARTIAL_HARMONICS];
+    int count;                            // Harmonics up to the last audible one
+} TimbreHarmonics;
+
+// Harmonics of current_wave_table (swapped with it)
+extern const TimbreHarmonics *current_harmonics;
+
+// --- 2. Timbre Crossfade ---
+// Default length of the crossfade after a new table is swapped in (0 = instant)
+constexpr int SYNTH_XFADE_BLOCKS = 8;
+constexpr int32_t XFADE_ONE_Q24 = 1 << 24;
+
+// While a crossfade runs, the table being faded out (NULL otherwise).
+// The weight of current_wave_table at the start of the block is
+// wavetable_xfade_q24 (Q24) and grows by wavetable_xfade_step per sample.
+extern int16_t *previous_wave_table;
+extern const TimbreHarmonics *previous_harmonics; // Harmonics of previous_wave_table
+extern int32_t wavetable_xfade_q24;
+extern int32_t wavetable_xfade_step;
 
 /**
- * @brief Generates the 4 base waveforms (Sine, Saw, Square, Triangle) 
- * and stores them in static memory. Must be called once at startup.
+ * @brief Mip level for a voice. Call once per block.
+ * Level L is alias-free for any increment below 2^(PHASE_SHIFT + L).
+ * @param inc DDS phase increment of the voice
+ */
+static inline int wavetable_mip_level(uint32_t inc) {
+    int level = 0;
+    while (level < WAVETABLE_MIP_LEVELS - 1 && (inc >> (PHASE_SHIFT + level)) != 0) {
+        level++;
+    }
+    return level;
+}
+
+/**
+ * @brief Picks the band-limited table for a voice. Call once per block.
+ */
+static inline const int16_t *wavetable_for_increment(uint32_t inc) {
+    return current_wave_table + wavetable_mip_level(inc) * WAVETABLE_LEN;
+}
+
+// --- 3. Function Prototypes ---
+
+/**
+ * @brief Fills the default (pure sine) synth table from the quarter-wave
+ * table, without any FFT; the mip-level FFTs are prepared on the first build.
+ * The 4 base waveforms (Sine, Saw, Square, Triangle) are compile-time
+ * constants: Saw, Square and Triangle in flash, the quarter-wave Sine in
+ * SRAM. Must be called once at startup.
  */
 void init_wavetables();
 
 /**
- * @brief Mixes the 4 base waves into the master SYNTH_TABLE.
+ * @brief Requests a new mix of the 4 base waves for the master SYNTH_TABLE.
+ * Non-blocking: the mix and its band-limited mip levels (one kiss_fftr + one
+ * kiss_fftri per level) are built into the shadow bank by service_synth_table().
+ * A newer request replaces one that hasn't finished building.
  * Weights are automatically normalized to prevent clipping.
  * * @param w_sine   Weight of Sine wave (0.0 - 1.0)
  * @param w_saw    Weight of Saw wave (0.0 - 1.0)
@@ -29,11 +112,60 @@ void init_wavetables();
 void set_synth_table(float w_sine, float w_saw, float w_square, float w_tri);
 
 /**
- * @brief Sets the envelope parameters. 
- * Currently hardcoded, but designed to take inputs later.
- * * @param attack_time   Pointer to write the attack time (ms)
- * @param release_time  Pointer to write the release time (ms)
+ * @brief Requests a synth table built directly from a harmonic profile
+ * (timbre capture). Same background build as set_synth_table(), minus the
+ * mix: the spectrum is written straight into the mip generator.
+ * Harmonics are summed in sine phase; amplitudes are normalized so the
+ * table can't clip.
+ * @param harmonic_amps Relative amplitude of harmonic h+1 at index h (>= 0)
+ * @param num_harmonics Entries in harmonic_amps (clamped to MAX_TIMBRE_HARMONICS)
+ */
+void set_synth_table_harmonics(const float *harmonic_amps, int num_harmonics);
+
+/**
+ * @brief Runs one slice of the background table build (a 128-sample mix chunk,
+ * the forward FFT or harmonic spectrum, or one mip level). Call once per main loop iteration.
+ * @return true while a build or swap is still outstanding
+ */
+bool service_synth_table();
+
+/**
+ * @brief true if service_synth_table() has a slice to run right now (a build
+ * is under way, or one is requested and the synthesis has taken the last
+ * table). A swap left to the synthesis doesn't count.
+ */
+bool synth_table_build_ready();
+
+/**
+ * @brief Finishes any requested build and swaps it in immediately.
+ * Blocking; for use before audio starts.
+ */
+void flush_synth_table();
+
+/**
+ * @brief Sets the crossfade length used when a new table is swapped in.
+ * @param blocks Output blocks to fade over (0 = hard switch)
+ */
+void set_synth_xfade_blocks(int blocks);
+
+// SRAM taken by the wavetables, in bytes
+typedef struct {
+    uint32_t synth_banks;    // SYNTH_TABLE: 2 banks x WAVETABLE_MIP_LEVELS levels
+    uint32_t sine_quarter;   // SRAM copy of the quarter-wave sine
+    uint32_t build_scratch;  // Mip generator buffers and per-bank harmonics
+    uint32_t fft_plans;      // Mip generator kissfft plans (heap, allocated on the first build)
+} WavetableMemory;
+
+/**
+ * @brief SRAM used by the wavetables, from the actual array and plan sizes.
+ */
+WavetableMemory get_wavetable_memory();
+
+/**
+ * @brief Synth side: swaps in a finished table and advances the crossfade.
+ * Call at the start of every output block, before any voice is rendered.
+ * @param num_samples Samples in the block about to be rendered
  */
-void set_synth_env(int16_t *attack_time, int16_t *release_time);
+void wavetable_block_boundary(uint num_samples);
 
 #endif /* WAVETABLES_H */
\ No newline at end of file
@@ -0,0 +1,156 @@
+/**
+ * File: phase_align_sim.cpp
+ * Description: Host simulation of the exciter driving a string.
+ * A damped string (one mode) is plucked, then driven through the loop latency
+ * by a voice rendered in O_BUFFER_SIZE blocks, with the string phase reported
+ * the way the analysis does (one frame per hop, measured at the frame center).
+ * Compares phase_align_increment() against unaligned voices and reports the
+ * sustain gain. Exits nonzero if the aligned voice does not sustain best.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+#include "phase_align.hpp"
+
+// --- Simulation Parameters ---
+constexpr double STRING_HZ = 111.5;            // Between two analysis bins
+constexpr double DECAY_S = 1.5;                // Amplitude time constant of the free string
+constexpr double DRIVE_AMPLITUDE = 0.5;        // Steady-state amplitude of an optimal drive
+constexpr double MEASURE_ERROR_HZ = 0.05;      // Frequency error of the analysis estimate
+constexpr double RUN_S = 6.0;
+constexpr double SUSTAIN_FROM_S = 0.5;         // Sustain window: after the voice starts...
+constexpr double SUSTAIN_TO_S = 3.0;           // ...until the pluck has died away
+constexpr double STEADY_FROM_S = 4.0;          // Steady-state window: to the end
+constexpr int    RANDOM_PHASES = 16;
+
+constexpr double BIN_HZ = (double)FS_I / FFT_SIZE;
+constexpr double FRAME_CENTER_S = (I_BUFFER_SIZE - 1) / (2.0 * FS_I);
+constexpr double HOP_S = (double)HOP_SIZE / FS_I;
+constexpr double FIRST_FRAME_S = (double)I_BUFFER_SIZE / FS_I;
+
+enum Mode { BIN_FREQUENCY, MEASURED_FREQUENCY, ALIGNED };
+
+struct Result {
+    double sustain_energy;   // Mean energy over the sustain window
+    double steady_energy;    // Mean energy over the steady-state window
+    double min_amplitude;    // Deepest dip after the voice starts
+};
+
+// String state in the sine convention: x = A sin(phi), v = A w cos(phi)
+static double string_phase(double x, double v, double w) {
+    double phi = atan2(w * x, v);
+    return phi < 0 ? phi + 2 * M_PI : phi;
+}
+
+static Result simulate(Mode mode, uint32_t start_phase) {
+    const double dt = 1.0 / FS_O;
+    const double w = 2 * M_PI * STRING_HZ;
+    const double damping = 2.0 / DECAY_S;                         // x'' + damping x' + w^2 x = F
+    const double gain = DRIVE_AMPLITUDE * w * damping;            // Resonant amplitude = F / (w damping)
+    const int latency_samples = (int)lround(DEFAULT_LOOP_LATENCY_US * 1e-6 * FS_O);
+    const int total = (int)(RUN_S * FS_O);
+
+    // Voice output only reaches the string after the loop latency
+    std::vector<double> delay(latency_samples + 1, 0.0);
+    int delay_pos = 0;
+
+    // Phase history, so a frame can report the phase at its center
+    std::vector<float> phase_history(total);
+
+    double x = 0.0, v = w;                                        // Pluck: amplitude 1, phase 0
+    bool voice_on = false;
+    uint32_t voice_phase = start_phase;
+    uint32_t increment = 0;
+    float measured_hz = 0.0f;
+    uint32_t measured_phase = 0, measured_us = 0;
+    double next_frame_s = FIRST_FRAME_S;
+
+    Result r = {0.0, 0.0, 1e9};
+    int sustain_n = 0, steady_n = 0;
+
+    for (int n = 0; n < total; n++) {
+        double t = n * dt;
+
+        // 1. Analysis frame: measured frequency, and the phase at the frame center
+        if (t >= next_frame_s) {
+            int center = (int)((next_frame_s - FRAME_CENTER_S) * FS_O);
+            measured_hz = (float)(STRING_HZ + MEASURE_ERROR_HZ);
+            measured_phase = (uint32_t)(int64_t)(phase_history[center] / (2 * M_PI) * two32);
+            measured_us = (uint32_t)(center * dt * 1e6);
+            next_frame_s += HOP_S;
+            if (!voice_on) {
+                voice_on = true;
+                double hz = (mode == BIN_FREQUENCY) ? round(STRING_HZ / BIN_HZ) * BIN_HZ : measured_hz;
+                increment = (uint32_t)(hz * DDS_FACTOR);
+            }
+        }
+
+        // 2. Block boundary: the aligned voice retunes once per block
+        if (voice_on && mode == ALIGNED && n % O_BUFFER_SIZE == 0) {
+            uint32_t play_us = (uint32_t)(t * 1e6);
+            phase_align_increment(measured_hz, measured_phase, measured_us, voice_phase, play_us,
+                                  DEFAULT_LOOP_LATENCY_US, DEFAULT_PHASE_OFFSET, O_BUFFER_SIZE, &increment);
+        }
+
+        // 3. Render one sample and push it through the loop latency
+        double out = voice_on ? sin(voice_phase / two32 * 2 * M_PI) : 0.0;
+        if (voice_on) voice_phase += increment;
+        delay[delay_pos] = out;
+        delay_pos = (delay_pos + 1) % (int)delay.size();
+        double force = gain * delay[delay_pos];
+
+        // 4. String: semi-implicit Euler
+        v += (force - damping * v - w * w * x) * dt;
+        x += v * dt;
+        phase_history[n] = (float)string_phase(x, v, w);
+
+        // 5. Statistics (energy normalized to amplitude^2)
+        double energy = x * x + (v / w) * (v / w);
+        if (t >= SUSTAIN_FROM_S && t < SUSTAIN_TO_S) { r.sustain_energy += energy; sustain_n++; }
+        if (t >= STEADY_FROM_S) { r.steady_energy += energy; steady_n++; }
+        if (t >= FIRST_FRAME_S && sqrt(energy) < r.min_amplitude) r.min_amplitude = sqrt(energy);
+    }
+    r.sustain_energy /= sustain_n;
+    r.steady_energy /= steady_n;
+    return r;
+}
+
+static double db(double a, double b) { return 10.0 * log10(a / b); }
+
+int main() {
+    printf("[Sim] String %.1f Hz, decay %.1f s, loop latency %u us, FS_O %d, block %d\n",
+           STRING_HZ, DECAY_S, (unsigned)DEFAULT_LOOP_LATENCY_US, FS_O, O_BUFFER_SIZE);
+
+    // 1. Unaligned voices
+    Result bin = simulate(BIN_FREQUENCY, 0);
+    Result measured = {0.0, 0.0, 0.0};
+    Result worst = {1e9, 1e9, 1e9};
+    for (int i = 0; i < RANDOM_PHASES; i++) {
+        Result r = simulate(MEASURED_FREQUENCY, (uint32_t)(i * (two32 / RANDOM_PHASES)));
+        measured.sustain_energy += r.sustain_energy / RANDOM_PHASES;
+        measured.steady_energy += r.steady_energy / RANDOM_PHASES;
+        measured.min_amplitude += r.min_amplitude / RANDOM_PHASES;
+        if (r.sustain_energy < worst.sustain_energy) worst = r;
+    }
+
+    // 2. Aligned voice (arbitrary start phase, the loop steers it)
+    Result aligned = simulate(ALIGNED, 0x9E3779B9);
+
+    printf("[Sim] %-30s %10s %10s %10s\n", "Voice", "Sustain E", "Steady E", "Min amp");
+    printf("[Sim] %-30s %10.4f %10.4f %10.4f\n", "Bin frequency, free phase", bin.sustain_energy, bin.steady_energy, bin.min_amplitude);
+    printf("[Sim] %-30s %10.4f %10.4f %10.4f\n", "Measured freq, mean of phases", measured.sustain_energy, measured.steady_energy, measured.min_amplitude);
+    printf("[Sim] %-30s %10.4f %10.4f %10.4f\n", "Measured freq, worst phase", worst.sustain_energy, worst.steady_energy, worst.min_amplitude);
+    printf("[Sim] %-30s %10.4f %10.4f %10.4f\n", "Phase aligned", aligned.sustain_energy, aligned.steady_energy, aligned.min_amplitude);
+    printf("[Sim] Sustain gain: %+.2f dB vs bin frequency, %+.2f dB vs mean phase, %+.2f dB vs worst phase\n",
+           db(aligned.sustain_energy, bin.sustain_energy), db(aligned.sustain_energy, measured.sustain_energy),
+           db(aligned.sustain_energy, worst.sustain_energy));
+    printf("[Sim] Steady gain:  %+.2f dB vs bin frequency, %+.2f dB vs mean phase\n",
+           db(aligned.steady_energy, bin.steady_energy), db(aligned.steady_energy, measured.steady_energy));
+
+    bool ok = aligned.sustain_energy > bin.sustain_energy && aligned.sustain_energy > measured.sustain_energy
+           && aligned.steady_energy > bin.steady_energy;
+    printf("[Sim] %s\n", ok ? "PASS" : "FAIL: the aligned voice does not sustain best");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,10 @@
+// Host stand-in for the Pico SDK header: placement attributes become no-ops.
+#ifndef HOST_PICO_PLATFORM_H
+#define HOST_PICO_PLATFORM_H
+
+#define __not_in_flash(group)
+#define __not_in_flash_func(func_name) func_name
+#define __scratch_x(group)
+#define __scratch_y(group)
+
+#endif // HOST_PICO_PLATFORM_H
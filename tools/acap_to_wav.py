@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""
+Acousynth raw ADC capture -> WAV.
+
+Reads the frames streamed by the firmware's USB capture mode (USB_CAPTURE in
+main.cpp, see acousynth/usb_capture.hpp) from the Pico's serial port or from
+a file recorded earlier, and writes the samples to a 16-bit mono WAV.
+
+Frame: CaptureHeader (20 bytes, little-endian) + num_samples raw 12-bit
+ADC samples (uint16). Text from printf between frames is skipped; frames
+failing the checksum are rejected. Missing sequence numbers are filled with
+silence so the WAV keeps the real timing, and reported at the end.
+
+Usage:
+    acap_to_wav.py /dev/ttyACM0 out.wav --seconds 30   (needs pyserial)
+    acap_to_wav.py capture.bin out.wav
+"""
+
+import argparse
+import os
+import struct
+import sys
+import time
+import wave
+
+MAGIC = b"ACAP"
+HEADER = struct.Struct("<IIIHHHH")  # magic, seq, capture_us, fs_hz, num_samples, checksum, flags
+ADC_MIDPOINT = 2048
+
+
+def open_source(path):
+    """Returns (stream, live): a recorded file is read to its end, a port for --seconds."""
+    if os.path.isfile(path):
+        return open(path, "rb"), False
+    import serial  # pyserial, only needed for live capture
+    return serial.Serial(path, timeout=0.1), True
+
+
+def parse_frames(buf):
+    """Returns the complete frames (seq, capture_us, fs_hz, samples) in buf,
+    the number rejected and the unparsed tail."""
+    frames = []
+    rejected = 0
+    pos = 0
+    while True:
+        start = buf.find(MAGIC, pos)
+        if start < 0:
+            pos = max(pos, len(buf) - (len(MAGIC) - 1))
+            break
+        if start + HEADER.size > len(buf):
+            pos = start
+            break
+        _, seq, capture_us, fs_hz, count, checksum, _ = HEADER.unpack_from(buf, start)
+        end = start + HEADER.size + 2 * count
+        if end > len(buf):
+            pos = start
+            break
+        samples = struct.unpack_from("<%dH" % count, buf, start + HEADER.size)
+        if sum(samples) & 0xFFFF != checksum:
+            rejected += 1
+            pos = start + 1  # Not a real frame (or a broken one): resync
+            continue
+        frames.append((seq, capture_us, fs_hz, samples))
+        pos = end
+    return frames, rejected, buf[pos:]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("source", help="serial port or recorded capture file")
+    ap.add_argument("wav", help="output WAV file")
+    ap.add_argument("--seconds", type=float, default=10.0, help="live capture length (default 10)")
+    ap.add_argument("--raw", help="also save the raw stream to this file")
+    args = ap.parse_args()
+
+    src, live = open_source(args.source)
+    raw_out = open(args.raw, "wb") if args.raw else None
+    deadline = time.monotonic() + args.seconds
+
+    pcm = bytearray()
+    buf = b""
+    fs_hz = None
+    next_seq = None
+    stats = {"frames": 0, "missing": 0, "rejected": 0}
+
+    while True:
+        chunk = src.read(4096)
+        if raw_out and chunk:
+            raw_out.write(chunk)
+        if not chunk and not live:
+            break
+        buf += chunk
+        frames, rejected, buf = parse_frames(buf)
+        stats["rejected"] += rejected
+        for seq, _, rate, samples in frames:
+            fs_hz = fs_hz or rate
+            if next_seq is not None and seq != next_seq:
+                gap = (seq - next_seq) & 0xFFFFFFFF
+                if gap < 0x80000000:
+                    stats["missing"] += gap
+                    pcm += bytes(2 * len(samples) * gap)
+            next_seq = (seq + 1) & 0xFFFFFFFF
+            pcm += struct.pack("<%dh" % len(samples),
+                               *[max(-32768, min(32767, (s - ADC_MIDPOINT) << 4)) for s in samples])
+            stats["frames"] += 1
+        if live and time.monotonic() > deadline:
+            break
+
+    src.close()
+    if raw_out:
+        raw_out.close()
+    if fs_hz is None:
+        sys.exit("No capture frames found (is USB_CAPTURE enabled?)")
+
+    with wave.open(args.wav, "wb") as w:
+        w.setnchannels(1)
+        w.setsampwidth(2)
+        w.setframerate(fs_hz)
+        w.writeframes(bytes(pcm))
+
+    print("%d frames at %d Hz -> %s (%.1f s), %d blocks missing, %d rejected"
+          % (stats["frames"], fs_hz, args.wav, len(pcm) / 2 / fs_hz,
+             stats["missing"], stats["rejected"]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""
+Acousynth memory placement report.
+
+Lists how much code and data landed in each RP2040 memory region and
+checks where the hot audio-path symbols ended up (see "Memory Placement"
+in acousynth/macros.hpp). Built as the `memmap_report` CMake target:
+
+    make memmap_report
+
+or run by hand on the ELF:
+
+    memmap_report.py --nm arm-none-eabi-nm build/acousynth.elf [--strict]
+
+--strict exits with status 1 if a hot symbol is not where it belongs.
+"""
+
+import argparse
+import re
+import subprocess
+import sys
+
+REGIONS = [
+    # name, start, end (exclusive)
+    ("FLASH (XIP)",  0x10000000, 0x11000000),
+    ("SRAM striped", 0x20000000, 0x20040000),
+    ("SCRATCH_X",    0x20040000, 0x20041000),
+    ("SCRATCH_Y",    0x20041000, 0x20042000),
+]
+RAM = ("SRAM striped", "SCRATCH_X", "SCRATCH_Y")
+
+# Symbol (base name, without arguments or template parameters) -> allowed regions
+EXPECTED = {
+    # Audio path code (__not_in_flash_func)
+    "dma_isr": RAM,
+    "fetch_o_samples": RAM,
+    "fill_o_buffer": RAM,
+    "render_oscillators": RAM,
+    "collect_voices": RAM,
+    "render_voice_list": RAM,
+    "apply_control_frame": RAM,
+    "track_playout": RAM,
+    "refill_isr": RAM,
+    "render_helper_isr": RAM,
+    "osc_table_const": RAM,
+    "osc_table_ramp": RAM,
+    "osc_table_interp_const": RAM,
+    "osc_table_interp_ramp": RAM,
+    "osc_xfade_const": RAM,
+    "osc_xfade_ramp": RAM,
+    "osc_xfade_interp_const": RAM,
+    "osc_xfade_interp_ramp": RAM,
+    "osc_recursive_const": RAM,
+    "osc_recursive_ramp": RAM,
+    "output_stage_process": RAM,
+    "env_advance": RAM,
+    "control_frame_receive": RAM,
+    "control_frame_release": RAM,
+    "wavetable_block_boundary": RAM,
+    "governor_block_boundary": RAM,
+    "ifft_set_timbre": RAM,
+    "ifft_add_partial": RAM,
+    "ifft_synthesize_frame": RAM,
+    # kissfft (KISS_FFT_RAM_CODE)
+    "kf_bfly2": RAM,
+    "kf_bfly4": RAM,
+    "kf_work": RAM,
+    "kiss_fft_stride": RAM,
+    "kiss_fftr": RAM,
+    "kiss_fftri": RAM,
+    # Tables (RAM_TABLE) and buffers
+    "SOFTCLIP_TABLE": RAM,
+    "ENV_CURVE": RAM,
+    "SINE_QUARTER_TABLE": RAM,
+    "SYNTH_TABLE": ("SRAM striped",),
+    "input_blocks": ("SRAM striped",),
+    "voice_rank_buf": ("SRAM striped",),   # Doesn't fit the audio scratch bank (fill_o_buffer)
+    # Per-core scratch (AUDIO_CORE_SCRATCH / HELPER_CORE_SCRATCH): X or Y
+    # depending on DUAL_CORE, checked against each other below
+    "mix_buffer": ("SCRATCH_X", "SCRATCH_Y"),
+    "voice_order": ("SCRATCH_X", "SCRATCH_Y"),
+    "helper_mix": ("SCRATCH_X", "SCRATCH_Y"),
+}
+
+# Buffers of the audio core and of the render helper must not share a bank
+AUDIO_CORE_BUFFERS = ("mix_buffer", "voice_order")
+HELPER_CORE_BUFFERS = ("helper_mix",)
+
+CODE_TYPES = set("tTwW")
+
+
+def region_of(addr):
+    for name, start, end in REGIONS:
+        if start <= addr < end:
+            return name
+    return None
+
+
+def base_name(sym):
+    # "fill_o_buffer(audio_buffer*)::mix_buffer" -> "mix_buffer"
+    # "void osc_kernel<A, B>(FreqData*, ...)"    -> "osc_kernel"
+    name = sym
+    if "::" in name and not name.endswith(")"):
+        name = name.rsplit("::", 1)[1]
+    name = re.split(r"[<(]", name, 1)[0]
+    return name.split()[-1] if name.split() else name
+
+
+def read_symbols(nm, elf):
+    out = subprocess.run([nm, "-S", "-C", "--defined-only", elf],
+                         check=True, capture_output=True, text=True).stdout
+    symbols = []
+    for line in out.splitlines():
+        parts = line.split(None, 3)
+        if len(parts) < 4:
+            continue  # No size: labels, section markers
+        addr, size, kind, name = int(parts[0], 16), int(parts[1], 16), parts[2], parts[3]
+        symbols.append((addr, size, kind, name))
+    return symbols
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("elf")
+    ap.add_argument("--nm", default="arm-none-eabi-nm")
+    ap.add_argument("--strict", action="store_true", help="fail if a hot symbol is misplaced")
+    args = ap.parse_args()
+
+    symbols = read_symbols(args.nm, args.elf)
+
+    # 1. Totals per region
+    print("%-14s %10s %10s" % ("Region", "Code", "Data"))
+    for name, start, end in REGIONS:
+        code = sum(s for a, s, k, _ in symbols if start <= a < end and k in CODE_TYPES)
+        data = sum(s for a, s, k, _ in symbols if start <= a < end and k not in CODE_TYPES)
+        print("%-14s %10d %10d" % (name, code, data))
+    print()
+
+    # 2. Hot symbols
+    found = {}
+    for addr, size, kind, name in symbols:
+        base = base_name(name)
+        if base in EXPECTED:
+            found.setdefault(base, []).append((addr, size, region_of(addr)))
+
+    misplaced = 0
+    print("%-26s %-14s %8s  %s" % ("Symbol", "Region", "Bytes", "Status"))
+    for base, allowed in EXPECTED.items():
+        if base not in found:
+            print("%-26s %-14s %8s  %s" % (base, "-", "-", "not found (inlined or not built)"))
+            continue
+        for addr, size, region in found[base]:
+            ok = region in allowed
+            misplaced += 0 if ok else 1
+            print("%-26s %-14s %8d  %s" % (base, region or hex(addr), size,
+                                           "ok" if ok else "MISPLACED (want %s)" % " / ".join(allowed)))
+
+    audio_banks = {r for b in AUDIO_CORE_BUFFERS for _, _, r in found.get(b, [])}
+    helper_banks = {r for b in HELPER_CORE_BUFFERS for _, _, r in found.get(b, [])}
+    if len(audio_banks) > 1 or audio_banks & helper_banks:
+        print("\nAudio core buffers (%s) and render helper buffers (%s) share a scratch bank"
+              % (" / ".join(sorted(audio_banks)), " / ".join(sorted(helper_banks))))
+        misplaced += 1
+
+    if misplaced:
+        print("\n%d hot symbol(s) not where they belong" % misplaced)
+        if args.strict:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()